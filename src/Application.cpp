@@ -3,6 +3,14 @@
 #include "Explosion.hpp"
 #include "Boids.hpp"
 #include "Mesh.hpp"
+#include "PointRenderer.hpp"
+#include "XmlParser.hpp"
+#include "WorkerPool.hpp"
+#include "FrameArena.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
 
 Application::Application():
 _windowWidth(800),	
@@ -13,9 +21,21 @@ m_goingLeft(false),
 m_goingRight(false),
 m_goingForward(false),
 m_goingBackward(false),
+m_loader(NULL),
+m_parser(NULL),
+m_nbFiguresAdded(0),
+m_nbFiguresToLoad(0),
+m_loadingDone(true),
 m_renderFlag(false),
+m_renderQueue(NULL),
+m_nbRenderWriters(1),
+m_pointRenderer(NULL),
+m_memoryReport(false),
+m_memoryPeak(0),
 m_camera(NULL)
 {
+	m_loadingMutex = SDL_CreateMutex();
+
 	//Fill up move values
 	_moveFlags[0]=0.0;
 	_moveFlags[1]=0.0;
@@ -37,16 +57,17 @@ void Application::initApplication()
 {
 	//Display parameters init
 	initDisplay();
-
-	//Timer init (24 fps)
-	_renderTimer = SDL_AddTimer(41, renderLoopTimer, this);
-	_renderTimer = SDL_AddTimer(80, refreshLoopTimer, this);
+	// Boids preview (needs the OpenGL context)
+	m_pointRenderer = new PointRenderer();
 
 	//Move counter
 	_cntMove = 0;
 	_playMove = 0;
+	_missedFrames = 0;
 	// Initialize the projection matrix
 	m_camera->setPerspectiveFromAngle();
+	// RIB writers overlap disk writes with the simulation
+	m_renderQueue = new RenderQueue(m_nbRenderWriters);
 
 	//Mouse is not going to leave the window
 	//Mouse won't be seeable
@@ -62,6 +83,8 @@ void Application::initDisplay()
 	int sdlError=SDL_Init(SDL_INIT_EVERYTHING);
 	if (sdlError<0) 
 		std::cout << "Unable to init SDL : " << SDL_GetError() << std::endl ;
+	// Scratch memory of the threads (its lock needs SDL)
+	FrameArena::init();
 
 	// Sets openGL parameters before opening the draw context
 	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);    // Double buffering
@@ -70,6 +93,7 @@ void Application::initDisplay()
 	SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
 	SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
 	SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_SWAP_CONTROL, 1);	// Swap on vertical sync
 
 	// Creation of the openGL draw context
 	const SDL_VideoInfo* videoInfo=SDL_GetVideoInfo();
@@ -78,6 +102,15 @@ void Application::initDisplay()
 
 	// Specifies the size and other options about the OpenGL window
 	_drawContext = SDL_SetVideoMode(_windowWidth, _windowHeight, 0, _videoModeFlags); 
+	int swapControl = 0;
+	SDL_GL_GetAttribute(SDL_GL_SWAP_CONTROL, &swapControl);
+	if(swapControl != 1)
+		std::cout << "WARNING no vertical sync, frames are paced by sleeping only" << std::endl;
+
+	// Load the OpenGL entry points (shaders, buffers)
+	GLenum glewError = glewInit();
+	if(glewError != GLEW_OK)
+		std::cout << "Unable to init GLEW : " << glewGetErrorString(glewError) << std::endl;
 
 	// Depth and Alpha test
 	glEnable(GL_DEPTH_TEST);
@@ -129,27 +162,54 @@ void Application::switchFullScreen()
     }
 }
 
-// Distributes task for the "user" kind of events 
-// For example : rendrFrame action occurs if a timer event is passed
-void Application::handleUserEvents(SDL_Event* event)
+// Steps the fixed clocks which are due
+// Returns true if the simulation moved (a new frame has to be drawn)
+bool Application::_stepClocks()
 {
-	switch (event->user.code) 
+	// Figures built by the loader since the last step
+	_collectLoadedFigures();
+
+	// Camera refresh : once when due, a late camera does not jump
+	Uint32 now = SDL_GetTicks();
+	if(now >= _nextRefreshTick)
 	{
-		// Frames update (24fps)
-		case MY_RENDER_LOOP:
-			drawFrame();
-			animate();
-			break;
-		
-		// Refresh update (1sec)
-		case FREE_REFRESH_LOOP:
-			if(m_camera->getMode() == "FPS")
-				tool_camera::manageFps(*(this), m_camera);
-			break;
+		if(m_camera->getMode() == "FPS")
+			tool_camera::manageFps(*(this), m_camera);
+		_nextRefreshTick += REFRESH_PERIOD;
+		if(now >= _nextRefreshTick)
+			_nextRefreshTick = now + REFRESH_PERIOD;
+	}
 
-		default:
-			break;
+	// Frames update (24fps) : late steps are caught up
+	// without drawing them, up to MAX_CATCHUP_STEPS
+	unsigned int nbSteps = 0;
+	while(SDL_GetTicks() >= _nextFrameTick && nbSteps < MAX_CATCHUP_STEPS)
+	{
+		animate();
+		_nextFrameTick += FRAME_PERIOD;
+		++nbSteps;
 	}
+	if(nbSteps > 1)
+		_missedFrames += nbSteps - 1;
+	// Still late : restart the clock from now
+	now = SDL_GetTicks();
+	if(now >= _nextFrameTick)
+	{
+		const Uint32 late = (now - _nextFrameTick) / FRAME_PERIOD + 1;
+		_missedFrames += late;
+		_nextFrameTick += late * FRAME_PERIOD;
+	}
+	return nbSteps > 0;
+}
+
+// Sleeps until the next clock step
+// SDL_Delay may wake a ms late : the fixed clocks absorb it (no active wait)
+void Application::_waitNextTick()
+{
+	const Uint32 next = std::min(_nextFrameTick, _nextRefreshTick);
+	const Uint32 now = SDL_GetTicks();
+	if(now < next)
+		SDL_Delay(next - now);
 }
 
 
@@ -177,26 +237,44 @@ void Application::handleKeyDownEvents(SDL_keysym* keysym)
 		// E : explose everything
 		case SDLK_e :
 			for(unsigned int i=0; i<m_figures.size(); ++i)
-				m_figures[i] = new Explosion(m_figures[i]);
+			{
+				Figure* source = m_figures[i];
+				m_figures[i] = m_figurePool.explosion(source, Explosion::defaultSettings());
+				m_figurePool.release(source);
+			}
 			break;
 
 		//@TO_REMOVE
 		// B : make everything as Boids
 		case SDLK_b :
 			for(unsigned int i=0; i<m_figures.size(); ++i)
-				m_figures[i] = new Boids(m_figures[i]);
+			{
+				Figure* source = m_figures[i];
+				m_figures[i] = m_figurePool.boids(source);
+				m_figurePool.release(source);
+			}
 			break;
 
 		// Space : launch play mode
 		// It is easier to keep the camera mode 
 		// as the global play mode for the Application
 		case SDLK_SPACE :
+			if(m_loader != NULL)
+			{
+				std::cout << "WARNING scene still loading, play mode not started" << std::endl;
+				break;
+			}
 			m_camera->startPlayMode();
 			break;
 		
 		// Render : launch the renderman rendermode
 		// Like a play mode but with the render option enabled
 		case SDLK_r :
+			if(m_loader != NULL)
+			{
+				std::cout << "WARNING scene still loading, render mode not started" << std::endl;
+				break;
+			}
 			m_renderFlag = true;
 			m_camera->startPlayMode();
 			break;
@@ -254,38 +332,49 @@ void Application::eventLoop()
 	SDL_Event event;
     	float test = 0.0f;
 
-	while( (!_done) && (SDL_WaitEvent( &event )) ) 
+	_nextFrameTick = _nextRefreshTick = SDL_GetTicks();
+	while(!_done)
 	{
-		switch(event.type) 
+		// Handle all of the pending events without blocking
+		while( (!_done) && (SDL_PollEvent( &event )) ) 
 		{
-			case SDL_USEREVENT:
-				handleUserEvents( &event );
-				break;
-			case SDL_KEYUP:
-				handleKeyUpEvents( &event.key.keysym );
-				break; 
-			case SDL_KEYDOWN:
-				handleKeyDownEvents( &event.key.keysym );
-				break;                                   
-			case  SDL_VIDEORESIZE: 
-				resize( event.resize.w, event.resize.h );
-				break;                      
-			case SDL_QUIT:
-				_done=true;
-				break;
-
-	   		// Manage the mouse motion
-			case SDL_MOUSEMOTION:
-				_xMousePosition += (float)event.motion.xrel/(float)_windowWidth * 1.2f;
-				test = _yMousePosition - (float)event.motion.yrel/(float)_windowHeight * 1.2f;
-				if((test>-M_PI) && (test<0.0f))
-					_yMousePosition -= (float)event.motion.yrel/(float)_windowHeight * 1.2f;
-
-				break;
-
-			default:
-				break;
-		} 
+			switch(event.type) 
+			{
+				case SDL_KEYUP:
+					handleKeyUpEvents( &event.key.keysym );
+					break; 
+				case SDL_KEYDOWN:
+					handleKeyDownEvents( &event.key.keysym );
+					break;                                   
+				case  SDL_VIDEORESIZE: 
+					resize( event.resize.w, event.resize.h );
+					break;                      
+				case SDL_QUIT:
+					_done=true;
+					break;
+
+		   		// Manage the mouse motion
+				case SDL_MOUSEMOTION:
+					_xMousePosition += (float)event.motion.xrel/(float)_windowWidth * 1.2f;
+					test = _yMousePosition - (float)event.motion.yrel/(float)_windowHeight * 1.2f;
+					if((test>-M_PI) && (test<0.0f))
+						_yMousePosition -= (float)event.motion.yrel/(float)_windowHeight * 1.2f;
+
+					break;
+
+				default:
+					break;
+			} 
+		}
+		// Present a new frame only when the simulation moved
+		// (the buffer swap waits for the vertical sync)
+		if(_stepClocks())
+		{
+			drawFrame();
+			// End of the frame : the scratch buffers of the main thread are given back
+			FrameArena::local().reset();
+		}
+		_waitNextTick();
 	}
 }
 
@@ -296,8 +385,6 @@ void Application::drawFrame()
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	//<DRAW HERE>
-	std::cout << "\nDRAW - FRAME : " << _cntMove << "(" << _playMove <<")" << std::endl;
-
 	// Sets the matrix mode
 	//@WARNING : Need a float* for modelview and projection in OpenGL
 	glMatrixMode (GL_PROJECTION);
@@ -313,13 +400,29 @@ void Application::drawFrame()
 	
 	glBegin(GL_POINTS);
 	glVertex3f(0.0f, 0.0f, -1.0f);
+	glEnd();
 	glColor3ub(255,255,255);
-	// Draw all of the figures
+	// Draw all of the figures seen by the camera, each one at its own placement
+	// Sprites are sized in pixels from the viewport height and the fov
+	const Frustum frustum = m_camera->frustum();
+	const float pixelsPerUnit = _windowHeight / (2.0f * m_camera->tanHalfFov());
 	for( unsigned int i=0; i<m_figures.size(); ++i)
-		m_figures[i]->brutalDraw();
-	glEnd();
+	{
+		if(!m_figures[i]->isVisible(frustum))
+			continue;
+		// Distant figures draw less, bigger points
+		const float lodRatio = m_figures[i]->lodRatio(m_camera->view(), m_camera->tanHalfFov());
+		float radiusScale, intensityScale;
+		Figure::lodCompensation(lodRatio, radiusScale, intensityScale);
+		m_figures[i]->drawPoints(m_drawPoints, frustum, lodRatio);
+		glPushMatrix();
+		glMultMatrixf(m_figures[i]->transform().data());
+		m_pointRenderer->draw(m_drawPoints, radiusScale, intensityScale, pixelsPerUnit);
+		glPopMatrix();
+	}
 	
 	tool_camera::drawTestScene();
+	_drawLoadingProgress();
 	//</DRAW HERE>
   
 	// Performs the buffer swap between the current shown buffer
@@ -331,8 +434,12 @@ void Application::animate()
 {
 	++_cntMove;
 	// Remove un-needed figures 
-	if(_cntMove%FREE_REFRESH_LOOP == 0)
+	// (not while loading : the animated data use the figure indices)
+	if(_cntMove%FREE_REFRESH_LOOP == 0 && m_loader == NULL)
 		_removeEmptyFigures();
+	// Memory in the window title (the loader shows its progress there)
+	if(_cntMove%MEMORY_REFRESH_LOOP == 0 && m_loader == NULL)
+		_updateMemoryHud();
 	// If in PLAY mode (no FPS)
 	if(m_camera->getMode() == "PLAY")
 	{
@@ -344,11 +451,13 @@ void Application::animate()
 		// Animate the figures
 		for(unsigned int i=0; i<m_figures.size(); ++i)
 		{
+			m_figures[i]->updateTransform(_playMove);
 			m_figures[i]->move();
+			m_figures[i]->record();
 			if(m_renderFlag)
 			{
 				m_figures[i]->setRenderCamera(m_camera->getRendermanTransform());
-				m_figures[i]->render();
+				m_figures[i]->render(*m_renderQueue);
 			}
 		}
 		// Test if play sequence is finished
@@ -356,6 +465,19 @@ void Application::animate()
 		// the data, at the end of the play sequence
 		if(m_camera->getMode() == "FPS")
 		{
+			// Let the writers finish the sequence
+			if(m_renderFlag)
+			{
+				m_renderQueue->wait();
+				m_renderQueue->clearArchives();
+			}
+			std::cout << "Play sequence done - missed frames : " << _missedFrames << std::endl;
+			FrameArena::report(std::cout);
+			if(m_memoryReport)
+				memoryReport(std::cout);
+			_closeRecorders();
+			m_memoryPeak = 0;
+			_missedFrames = 0;
 			_reset();
 			m_renderFlag = false;
 			for(unsigned int i=0; i<m_figures.size(); ++i)
@@ -367,26 +489,212 @@ void Application::animate()
 // Cleans before the application can be closed
 void Application::deleteApplication()
 {
+	// Let the loader end, its last figures are freed with the others
+	if(m_loader != NULL)
+	{
+		SDL_WaitThread(m_loader, NULL);
+		m_loader = NULL;
+		delete m_parser;
+		m_figures.insert(m_figures.end(), m_loadedFigures.begin(), m_loadedFigures.end());
+		m_recorders.insert(m_recorders.end(), m_loadedRecorders.begin(), m_loadedRecorders.end());
+		m_loadedFigures.clear();
+		m_loadedRecorders.clear();
+	}
+	SDL_DestroyMutex(m_loadingMutex);
+	// A play sequence not finished leaves no particle cache
+	for(unsigned int i=0; i<m_recorders.size(); ++i)
+		delete m_recorders[i];
+	m_recorders.clear();
 	// Free all of the figures
 	for(unsigned int i=0; i<m_figures.size(); ++i)
-		free(m_figures[i]);
+		m_figurePool.release(m_figures[i]);
+	m_figures.clear();
+	m_figurePool.clear();
+	// Finish the pending RIB files
+	delete m_renderQueue;
+	// Stop the simulation threads
+	WorkerPool::releaseShared();
+	// Every thread using an arena is ended
+	FrameArena::releaseAll();
+	delete m_pointRenderer;
 	// Free the camera
-	free(m_camera);
+	delete m_camera;
+	m_camera = NULL;
 	// Clean SDL quit
-	SDL_RemoveTimer(_renderTimer);
 	SDL_Quit();
 }
 
-// Add a new figure to the Application
+// Build the figures of the scene on a background thread
+// The parser is owned by the application
+void Application::loadFigures(XmlParser* parser)
+{
+	m_parser = parser;
+	m_nbFiguresToLoad = parser->nbFigures();
+	m_loadingDone = false;
+	m_loader = SDL_CreateThread(_loaderLoop, this);
+}
+
+// Loader thread entry point
+int Application::_loaderLoop(void* application)
+{
+	Application* self = (Application*) application;
+	self->m_parser->addFigures();
+	SDL_LockMutex(self->m_loadingMutex);
+	self->m_loadingDone = true;
+	SDL_UnlockMutex(self->m_loadingMutex);
+	return 0;
+}
+
+// Move the figures built by the loader into the scene
+// Figures keep the order of the scene file (animated data indices stay valid)
+void Application::_collectLoadedFigures()
+{
+	if(m_loader == NULL)
+		return;
+	SDL_LockMutex(m_loadingMutex);
+	const bool done = m_loadingDone;
+	m_figures.insert(m_figures.end(), m_loadedFigures.begin(), m_loadedFigures.end());
+	m_animatedData.insert(m_animatedData.end(), m_loadedAnimatedData.begin(), m_loadedAnimatedData.end());
+	m_recorders.insert(m_recorders.end(), m_loadedRecorders.begin(), m_loadedRecorders.end());
+	m_loadedFigures.clear();
+	m_loadedAnimatedData.clear();
+	m_loadedRecorders.clear();
+	SDL_UnlockMutex(m_loadingMutex);
+
+	// Progress in the window title
+	std::stringstream caption;
+	caption << "FumiGen - loading " << m_figures.size() << "/" << m_nbFiguresToLoad;
+	if(done)
+	{
+		SDL_WaitThread(m_loader, NULL);
+		m_loader = NULL;
+		delete m_parser;
+		m_parser = NULL;
+		caption.str("FumiGen");
+		std::cout << "Scene loaded : " << m_figures.size() << " figures" << std::endl;
+		if(m_memoryReport)
+			memoryReport(std::cout);
+	}
+	SDL_WM_SetCaption(caption.str().c_str(), NULL);
+}
+
+// Draw the loading progress bar (bottom of the window)
+void Application::_drawLoadingProgress()
+{
+	if(m_loader == NULL || m_nbFiguresToLoad == 0)
+		return;
+	const float progress = (float)m_figures.size() / (float)m_nbFiguresToLoad;
+	glDisable(GL_DEPTH_TEST);
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+	glBegin(GL_QUADS);
+	// Background
+	glColor3ub(60,60,60);
+	glVertex2f(-0.9f, -0.95f);
+	glVertex2f(0.9f, -0.95f);
+	glVertex2f(0.9f, -0.9f);
+	glVertex2f(-0.9f, -0.9f);
+	// Loaded figures
+	glColor3ub(255,255,255);
+	glVertex2f(-0.9f, -0.95f);
+	glVertex2f(-0.9f + 1.8f*progress, -0.95f);
+	glVertex2f(-0.9f + 1.8f*progress, -0.9f);
+	glVertex2f(-0.9f, -0.9f);
+	glEnd();
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glEnable(GL_DEPTH_TEST);
+}
+
+// Print the memory held by each figure and subsystem
+void Application::memoryReport(std::ostream& out)
+{
+	out << "Memory report - frame " << _cntMove << " (" << _playMove << ")" << std::endl;
+	const MemoryUsage total = _memoryUsage(&out);
+	tool_memory::printUsage(out, "total", total);
+	m_memoryPeak = std::max(m_memoryPeak, total.total());
+	out << "  peak of the play sequence (sampled every " << MEMORY_REFRESH_LOOP << " frames) : " \
+	    << tool_memory::format(m_memoryPeak) << std::endl;
+}
+
+// Memory - sum the memory of the figures and subsystems (detail : one line each, or NULL)
+// Nothing is allocated without detail (called during play for the window title)
+MemoryUsage Application::_memoryUsage(std::ostream* detail)
+{
+	MemoryUsage total;
+	for(unsigned int i=0; i<m_figures.size(); ++i)
+	{
+		const MemoryUsage usage = m_figures[i]->memoryUsage();
+		if(detail != NULL)
+			tool_memory::printUsage(*detail, m_figures[i]->type() + "_" + m_figures[i]->name(), usage);
+		total += usage;
+	}
+	// Subsystems
+	if(m_camera != NULL)
+		_addMemoryUsage(detail, "camera", m_camera->memoryUsage(), total);
+	_addMemoryUsage(detail, "figure pool", m_figurePool.memoryUsage(), total);
+	MemoryUsage recorders;
+	for(unsigned int i=0; i<m_recorders.size(); ++i)
+		recorders += m_recorders[i]->memoryUsage();
+	_addMemoryUsage(detail, "particle cache recorders", recorders, total);
+	if(m_renderQueue != NULL)
+		_addMemoryUsage(detail, "render jobs", m_renderQueue->memoryUsage(), total);
+	MemoryUsage buffers;
+	buffers.scratch = FrameArena::totalCapacity() + tool_memory::bytes(m_drawPoints);
+	_addMemoryUsage(detail, "frame arenas and draw buffer", buffers, total);
+	return total;
+}
+
+// Memory - add a subsystem to the total (and its line to the detail)
+void Application::_addMemoryUsage(std::ostream* detail, const char* label, const MemoryUsage& usage, MemoryUsage& total)
+{
+	if(detail != NULL)
+		tool_memory::printUsage(*detail, label, usage);
+	total += usage;
+}
+
+// Memory - show the total in the window title, keep the peak
+void Application::_updateMemoryHud()
+{
+	const size_t total = _memoryUsage(NULL).total();
+	m_memoryPeak = std::max(m_memoryPeak, total);
+	char caption[128];
+	snprintf(caption, sizeof(caption), "FumiGen - memory : %.2f MB (peak %.2f MB)", \
+		 total / (1024.0 * 1024.0), m_memoryPeak / (1024.0 * 1024.0));
+	SDL_WM_SetCaption(caption, NULL);
+}
+
+// Add a new figure to the Application (safe from the loader thread)
+// It is drawn from the next frame on
 void Application::addFigure(Figure* f)
 {
-	m_figures.push_back(f);
+	SDL_LockMutex(m_loadingMutex);
+	m_loadedFigures.push_back(f);
+	++m_nbFiguresAdded;
+	SDL_UnlockMutex(m_loadingMutex);
 }
 
-// Add an animation data for the Application
+// Add an animation data for the Application (safe from the loader thread)
 void Application::addAnimatedData(AnimatedData & a)
 {
-	m_animatedData.push_back(a);
+	SDL_LockMutex(m_loadingMutex);
+	m_loadedAnimatedData.push_back(a);
+	SDL_UnlockMutex(m_loadingMutex);
+}
+
+// Add a particle cache recorder, owned by the Application (safe from the loader thread)
+// The cache is written at the end of the first play sequence
+void Application::addRecorder(ParticleCacheWriter* recorder)
+{
+	SDL_LockMutex(m_loadingMutex);
+	m_loadedRecorders.push_back(recorder);
+	SDL_UnlockMutex(m_loadingMutex);
 }
 
 // Set the camera of the Application
@@ -404,12 +712,28 @@ void Application::_removeEmptyFigures()
 	{
 		if( !m_figures[i]->isNeeded())
 		{
-			free(m_figures[i]);
+			m_figurePool.release(m_figures[i]);
 			m_figures.erase(m_figures.begin()+i);
 		}
 	}
 }
 
+// Write the particle caches recorded by the play sequence
+// The figures stop recording, the caches are replayed from the next run
+void Application::_closeRecorders()
+{
+	if(m_recorders.empty())
+		return;
+	for(unsigned int i=0; i<m_figures.size(); ++i)
+		m_figures[i]->setRecorder(NULL);
+	for(unsigned int i=0; i<m_recorders.size(); ++i)
+	{
+		m_recorders[i]->close();
+		delete m_recorders[i];
+	}
+	m_recorders.clear();
+}
+
 // Reset scene : rebuild the transformed Figures
 void Application::_reset()
 {
@@ -421,7 +745,7 @@ void Application::_reset()
 		// remove the previous figure from the list
 		if(animation.frameExplosion == 0)
 		{ 
-			free(m_figures[animation.indexFigure]);
+			m_figurePool.release(m_figures[animation.indexFigure]);
 			m_figures.erase(m_figures.begin()+animation.indexFigure);
 		}
 		// Create a new Figure from scratch
@@ -433,8 +757,12 @@ void Application::_reset()
 				animation.meshFilesPath, \
 				animation.m_startSequence, \
 				animation.m_endSequence, \
-				animation.m_density \
+				animation.m_density, \
+				animation.randomKey, \
+				animation.frameStorage \
 			);
+			new_mesh->setTransformKeys(animation.transformKeys);
+			new_mesh->setLodDensity(animation.lodDensity);
 			// Insert the new Figure at same position
 			m_figures.insert( \
 				m_figures.begin()+animation.indexFigure, \
@@ -449,8 +777,12 @@ void Application::_reset()
 				animation.b_nbUnities, \
 				animation.boidFilesPath, \
 				animation.b_startSequence, \
-				animation.b_endSequence \
+				animation.b_endSequence, \
+				animation.b_sizeBox, \
+				animation.randomKey \
 			);
+			new_boids->setTransformKeys(animation.transformKeys);
+			new_boids->setLodDensity(animation.lodDensity);
 			// Insert the new Figure at same position
 			m_figures.insert( \
 				m_figures.begin()+animation.indexFigure, \
@@ -468,46 +800,24 @@ void Application::_transform()
 		AnimatedData animation = m_animatedData[i];
 		unsigned int idx = animation.indexFigure;
 		// Turn the current figure into a Boid system
+		// (the previous figure goes back to the pool)
 		if(animation.frameBoids == _playMove)
 		{
-			m_figures[idx] = new Boids( \
-				m_figures[idx], \
+			Figure* source = m_figures[idx];
+			m_figures[idx] = m_figurePool.boids( \
+				source, \
 				animation.boidFilesPath, \
 				animation.b_startSequence, \
 				animation.b_endSequence \
 			);
+			m_figurePool.release(source);
 		}
 		// Turn the current figure into an Explosion
 		else if(animation.frameExplosion == _playMove)
-			m_figures[idx] = new Explosion(m_figures[idx]);
+		{
+			Figure* source = m_figures[idx];
+			m_figures[idx] = m_figurePool.explosion(source, animation.explosionSettings);
+			m_figurePool.release(source);
+		}
 	}
 }
-
-// Utils
-
-// Create an user event for the render loop (the id is "MY_RENDER_LOOP")
-// and registers it : it should now be send every "interval" set of time
-Uint32 renderLoopTimer(Uint32 interval, void* param)
-{
-    SDL_Event event;
-    event.type = SDL_USEREVENT;
-    event.user.code = MY_RENDER_LOOP;
-    event.user.data1 = 0;
-    event.user.data2 = 0;
-    SDL_PushEvent(&event);
-    return interval;
-}
-
-// Create an user event for the render loop (the id is "MY_RENDER_LOOP")
-// and registers it : it should now be send every "interval" set of time
-Uint32 refreshLoopTimer(Uint32 interval, void* param)
-{
-    SDL_Event event;
-    event.type = SDL_USEREVENT;
-    event.user.code = FREE_REFRESH_LOOP;
-    event.user.data1 = 0;
-    event.user.data2 = 0;
-    SDL_PushEvent(&event);
-    return interval;
-} 
-
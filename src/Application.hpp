@@ -8,7 +8,13 @@
 
 #include "Variables.h"
 #include "Figure.hpp"
+#include "Explosion.hpp"
 #include "Camera.hpp"
+#include "FigurePool.hpp"
+#include "FrameSequence.hpp"
+
+class PointRenderer;
+class XmlParser;
 
 // This structure allow to store all of the scripted animation
 // and make sure we are able to restart the scene from start at 
@@ -21,11 +27,17 @@ typedef struct
 	unsigned int m_startSequence;	// First frame of the sequence mesh
 	unsigned int m_endSequence;	// Last frame of the sequence mesh
 	unsigned int b_nbUnities;	// Nb of boids unities in the boids system
+	float b_sizeBox;		// Size of the box the boids system starts in
 	unsigned int b_startSequence;	// First frame of the sequence boids system
 	unsigned int b_endSequence;	// Last frame of the sequence boids system
 	unsigned int frameBoids;	// Frame to turn into boids system
 	unsigned int frameExplosion;	// Frame to explose the Figure
 	float m_density;		// Density of the Figure
+	FrameStorage frameStorage;	// Frames of the Mesh in memory
+	std::vector<TransformKey> transformKeys;	// Placement keys of the Figure
+	float lodDensity;		// Boids kept when the Figure fills the screen (0 : no LOD)
+	ExplosionSettings explosionSettings;	// Shape of the explosion
+	uint32_t randomKey;		// Random key of the Figure (same numbers when rebuilt)
 }
 AnimatedData;
 
@@ -33,8 +45,10 @@ class Application
 {
 	
 private :
-	// Timers
-	SDL_TimerID _renderTimer; 				// timer for the rendering
+	// Frame pacing (fixed clocks, in SDL ticks)
+	Uint32 _nextFrameTick;					// next simulation step
+	Uint32 _nextRefreshTick;				// next FPS camera refresh
+	unsigned int _missedFrames;				// simulation steps not presented on time
 	SDL_Surface* _drawContext;	
 	
 	// Windows parameters
@@ -63,9 +77,28 @@ private :
 	// Figure parameters
 	std::vector<Figure*> m_figures;				// Contains all of the figures defined
 	std::vector<AnimatedData> m_animatedData;		// Contains all of the animated data
+	std::vector<ParticleCacheWriter*> m_recorders;		// particle caches written by the first play sequence
+	FigurePool m_figurePool;				// releases the removed figures, keeps the transient ones
+
+	// Background loading (the loader adds, the main loop collects)
+	SDL_Thread * m_loader;					// builds the figures of the scene (NULL once done)
+	XmlParser * m_parser;					// scene read by the loader
+	SDL_mutex * m_loadingMutex;				// protects the loaded members below
+	std::vector<Figure*> m_loadedFigures;			// figures built, not drawn yet
+	std::vector<AnimatedData> m_loadedAnimatedData;		// animated data of the loaded figures
+	std::vector<ParticleCacheWriter*> m_loadedRecorders;	// particle cache recorders of the loaded figures
+	unsigned int m_nbFiguresAdded;				// figures added by the loader
+	unsigned int m_nbFiguresToLoad;				// figures declared in the scene
+	bool m_loadingDone;					// set by the loader when it ends
 
 	//Others
 	bool m_renderFlag;					// set to true when the process is rendering using Renderman
+	RenderQueue * m_renderQueue;				// writes the RIB files in background
+	unsigned int m_nbRenderWriters;				// number of RIB writer threads (0 : synchronous)
+	PointRenderer * m_pointRenderer;			// draws the boids as point sprites
+	bool m_memoryReport;					// print the memory report (loaded scene, end of play)
+	size_t m_memoryPeak;					// largest memory seen during the play sequence
+	std::vector<float> m_drawPoints;			// points of the figure being drawn (reused)
 	Camera * m_camera;					// the FPS camera
 	unsigned int _cntMove; 					// Move counter (total frame number)
 	unsigned int _playMove;					// Play move counter (frame of the played sequence)
@@ -90,9 +123,6 @@ public :
 	// SDL MANAGEMENT
 	// Distributes task for the "key" kind of events 
 	// For example : std::cout when b key is pressed
-	void handleUserEvents(SDL_Event* event);
-	// Distributes task for the "user" kind of events 
-	// For example : rendrFrame action occurs if a timer event is passed
 	void handleKeyUpEvents(SDL_keysym* keysym);
 	void handleKeyDownEvents(SDL_keysym* keysym);
 
@@ -120,29 +150,60 @@ public :
 	void deleteApplication();
 
 	// FIGURES MANAGEMENT
-	// Add a new figure to the Application
+	// Build the figures of the scene on a background thread
+	// The parser is owned by the application
+	void loadFigures(XmlParser* parser);
+	// Add a new figure to the Application (safe from the loader thread)
+	// It is drawn from the next frame on
 	void addFigure(Figure* f);
-	// Return the number of Figure stored into the application
-	inline unsigned int nbUnities() const { return m_figures.size(); }
+	// Return the number of Figure added into the application
+	inline unsigned int nbUnities() const { return m_nbFiguresAdded; }
 	// Set the camera of the Application
 	void defineCamera(Camera* camera);
-	// Add an animation data for the Application
+	// Set the number of RIB writer threads (0 to write synchronously)
+	inline void setRenderWriters(const unsigned int nb) { m_nbRenderWriters = nb; }
+	// Print the memory report once the scene is loaded and at the end of each play sequence
+	inline void setMemoryReport(const bool report) { m_memoryReport = report; }
+	// Print the memory held by each figure and subsystem
+	void memoryReport(std::ostream& out);
+	// Add an animation data for the Application (safe from the loader thread)
 	void addAnimatedData(AnimatedData & a);
+	// Add a particle cache recorder, owned by the Application (safe from the loader thread)
+	// The cache is written at the end of the first play sequence
+	void addRecorder(ParticleCacheWriter* recorder);
 
 private :
+	// Loader thread entry point
+	static int _loaderLoop(void* application);
+	// Move the figures built by the loader into the scene
+	void _collectLoadedFigures();
+	// Draw the loading progress bar
+	void _drawLoadingProgress();
+
+	// Memory - sum the memory of the figures and subsystems (detail : one line each, or NULL)
+	MemoryUsage _memoryUsage(std::ostream* detail);
+	// Memory - add a subsystem to the total (and its line to the detail)
+	void _addMemoryUsage(std::ostream* detail, const char* label, const MemoryUsage& usage, MemoryUsage& total);
+	// Memory - show the total in the window title, keep the peak
+	void _updateMemoryHud();
+
 	// Remove un-needed figures
 	void _removeEmptyFigures();
+	// Write the particle caches recorded by the play sequence
+	void _closeRecorders();
 
 	// Animation/Play functions
 	// Reset scene : rebuild the transformed Figures
 	void _reset();
 	// Check transformation of the stored Figures
 	void _transform();
-};
 
-// Create an user event for the render loop (the id is "MY_RENDER_LOOP")
-// and registers it : it should now be send every "interval" set of time
-Uint32 renderLoopTimer(Uint32 interval, void* param);
-Uint32 refreshLoopTimer(Uint32 interval, void* param);
+	// Frame pacing
+	// Steps the fixed clocks which are due
+	// Returns true if the simulation moved (a new frame has to be drawn)
+	bool _stepClocks();
+	// Sleeps until the next clock step
+	void _waitNextTick();
+};
 
 #endif 
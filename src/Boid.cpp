@@ -1,18 +1,21 @@
 #include "Boid.hpp"
+#include "Random.hpp"
 
 #include <cstdlib>
 
 // Builder
-Boid::Boid(const int idBoid)
+Boid::Boid(const int idBoid, const uint32_t figureKey)
 {
 	m_idBoid = idBoid;
-	m_intensity = rand()/(float) RAND_MAX;
-	m_size = rand()/(float) RAND_MAX;
+	float random[4];
+	tool_random::uniform4(figureKey, tool_random::STREAM_BOID, idBoid, 0, random);
+	m_intensity = random[0];
+	m_size = random[1];
 	// Define basic position in origin
 	for(unsigned int i=0; i<3; ++i)
 	{
-		m_position.push_back(0.0f);
-		m_velocite.push_back(0.0f);
+		m_position[i] = 0.0f;
+		m_velocite[i] = 0.0f;
 	}
 	// Manage leaderShip
 	if(m_idBoid == 0)
@@ -22,8 +25,7 @@ Boid::Boid(const int idBoid)
 }
 
 // Move boid
-void Boid::move(const std::vector<float> newPosition, 
-	  	const std::vector<float> newVelocity )
+void Boid::move(const float newPosition[3], const float newVelocity[3])
 {
 	for(unsigned int i=0; i<3; ++i)
 	{
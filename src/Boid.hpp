@@ -5,6 +5,7 @@
 #include <cstdlib>
 #include <iostream>
 #include <vector>
+#include <stdint.h>
 
 #include "Boid.hpp"
 
@@ -12,8 +13,8 @@ class Boid
 {
 	private :
 	int m_idBoid;				// id of the boid
-	std::vector<float> m_position;		// current position of the boid
-	std::vector<float> m_velocite;		// velocity of the boid
+	float m_position[3];			// current position of the boid
+	float m_velocite[3];			// velocity of the boid
 	int m_leaderShip;			// 1000 if leader, 1 else
 	float m_intensity;			// 1 to 0
 	// Renderman parameters
@@ -26,13 +27,14 @@ class Boid
 	inline float const leaderShip() const {return m_leaderShip;};
 	inline void setLeaderShip(const int value){m_leaderShip = value;};
 	inline float size() const { return m_size; }
+	inline void setSize(const float size) { m_size = size; }
 
 	// Builder
-	Boid(const int idBoid);
+	// figureKey : random key of the figure (intensity and size depend on it and idBoid)
+	Boid(const int idBoid, const uint32_t figureKey=0);
 	
 	// Move boid
-	void move(const std::vector<float> newPosition, 
-		  const std::vector<float > newVelocity );
+	void move(const float newPosition[3], const float newVelocity[3]);
 
 	// Get boid position
 	std::vector<float> getPosition();
@@ -1,11 +1,16 @@
 #include "Boids.hpp"
 #include "Tools.hpp"
+#include "Random.hpp"
+#include "FigurePool.hpp"
+
+#include <algorithm>
 
 // Builder
 // nbUnits : how many units inside the group
-Boids::Boids(const int nbUnits, const float sizeBox):
+Boids::Boids(const int nbUnits, const float sizeBox, const uint32_t randomKey):
 m_currentFrame(0)
 {
+	m_randomKey = randomKey;
 	m_type = "BOIDS_SYSTEM"; 
 	// Construct a default origin to 0,0,0
 	for( unsigned int i=0; i<3; ++i )
@@ -14,9 +19,10 @@ m_currentFrame(0)
 	_init(nbUnits, sizeBox);
 }
 
-Boids::Boids(const int nbUnits, const std::vector<float> origin, const float sizeBox):
+Boids::Boids(const int nbUnits, const std::vector<float> origin, const float sizeBox, const uint32_t randomKey):
 m_currentFrame(0)
 {
+	m_randomKey = randomKey;
 	m_type = "BOIDS_SYSTEM";
 	// Set boid system origin
 	for(unsigned int i=0; i<3; ++i)
@@ -26,9 +32,11 @@ m_currentFrame(0)
 }
 
 // Construct a boids system with an animated leader
-Boids::Boids(const int nbUnits, const std::string filepath, const int start, const int end, const float sizeBox):
+Boids::Boids(const int nbUnits, const std::string filepath, const int start, const int end,
+	     const float sizeBox, const uint32_t randomKey):
 m_currentFrame(0)
 {
+	m_randomKey = randomKey;
 	m_type = "BOIDS_SYSTEM";
 	_readLeaderInformation(filepath, start, end);
 	// Init boids
@@ -36,47 +44,84 @@ m_currentFrame(0)
 }
 
 // Construct a boids system from Mesh or something else - with animated leader
-//@WARNING: Destroy the previous figure
+// The previous figure is left to its owner
 Boids::Boids(Figure* b, const std::string filepath, const int start, const int end)
+{
+	makeFrom(b, filepath, start, end);
+}
+
+// Make the boids system (again) from another figure
+// A reused system keeps the capacity of its buffers
+void Boids::makeFrom(Figure* b, const std::string filepath, const int start, const int end)
 {
 	// Check if given Figure is already a Boids system
 	if(b->type() == "BOIDS_SYSTEM")
 		std::cout << "WARNNING given figure i already a Boids system" << std::endl;
 
+	_clearFigure();
+	m_currentFrame = 0;
+	m_leaderPositions.clear();
+	c_origin.assign(3, 0.0f);
+	c_sizeBox = DEFAULT_SIZE_BOX;
 	m_type = "BOIDS_SYSTEM_FROM_" + b->type();
+	m_transient = true;
+	// Keep the placement, LOD and random key of the previous figure
+	_inheritSettings(b);
 
 	// Generate the animated parameters if providen
 	if(filepath != "" && end != 0)
 		_readLeaderInformation(filepath, start, end);
 
 	//@WARNING use an int to prevent from warning
+	m_group.reserve(b->size());
 	for(int i=0; i<b->size(); ++i)
 	{
-		Boid newBoid(i);
+		Boid newBoid(i, m_randomKey);
 		for(unsigned int idx=0; idx<3; ++idx)
 			newBoid.setPosition(idx, b->getBoid(i).position(idx));
 		newBoid.setIntensity(b->getBoid(i).intensity());
 		m_group.push_back(newBoid);
 	}
-	free(b);
+	_updateBounds();
 }
 
 // Init boid system
-void Boids::_init(const int nbUnits, const int sizeBox)
+void Boids::_init(const int nbUnits, const float sizeBox)
 {
 	m_group.clear();
 	// Fill up global box constants
 	c_sizeBox = sizeBox ;
 
+	// Grid of the global box, one cell per boid box
+	PlacementGrid grid;
+	grid.nx = std::max(1, (int)ceil(c_sizeBox / c_widthOneBoid));
+	grid.ny = std::max(1, (int)ceil(c_sizeBox / c_heigthOneBoid));
+	grid.nz = std::max(1, (int)ceil(c_sizeBox / c_deepOneBoid));
+	// Hash table of the anchored cells, at most half full
+	uint64_t slots = 16;
+	while(slots < 2 * (uint64_t)std::max(nbUnits, 0))
+		slots *= 2;
+	grid.keys.assign(slots, 0);
+	grid.boids.assign(slots, -1);
+	grid.mask = slots - 1;
+	grid.nextFreeCell = 0;
+
 	// Creation of the group
 	//@WARNING use an int to avoid warnings on build
+	m_group.reserve(nbUnits);
 	for(int i=0; i<nbUnits ; ++i)
 	{
 		// Create the new boid
 		const int boidId = m_group.size();
-		Boid b(boidId);
+		Boid b(boidId, m_randomKey);
 		m_group.push_back(b);
-		computeInitialPosition(boidId);
+		if(!computeInitialPosition(boidId, grid))
+		{
+			m_group.pop_back();
+			std::cout << "WARNING boids system box full : " << m_group.size() << " of " << nbUnits \
+				  << " boids fit a box of size " << c_sizeBox << std::endl;
+			break;
+		}
 	}
 	
 	if(m_group.size() > 0)
@@ -84,6 +129,7 @@ void Boids::_init(const int nbUnits, const int sizeBox)
 		m_group[0].setLeaderShip(1000); 
 	else
 		std::cout << "Empty boids system" << std::endl;
+	_updateBounds();
 }
 
 // Read the position information for the leader and build animated parameters
@@ -134,10 +180,10 @@ void Boids::_readLeaderInformation(const std::string filepath, const int start,
 			else
 				++mesh_index;
 		}
+		lib3ds_file_free(l_file);
 	}	
 	// Origin is the leader position at first frame
-	for(unsigned int i=0; i<3; ++i)
-		c_origin.push_back(m_leaderPositions[0][i]);
+	c_origin.assign(m_leaderPositions[0].begin(), m_leaderPositions[0].end());
 }
 
 // Abstract move function overwritten
@@ -158,7 +204,22 @@ void Boids::move()
 		// Recreate boids from nowhere
 		_init(m_group.size(), c_sizeBox);
 	}
+	_updateBounds();
+}
+
+// Memory - bytes held by the boids system (leader positions : frame cache)
+MemoryUsage Boids::memoryUsage() const
+{
+	MemoryUsage usage = Figure::memoryUsage();
+	usage.frameCache += tool_memory::bytes(m_leaderPositions);
+	usage.scratch += tool_memory::bytes(c_origin);
+	return usage;
+}
 
+// Pool - a boids system made from another figure is kept for reuse
+bool Boids::recycle(FigurePool& pool)
+{
+	return m_transient && pool.keep(this);
 }
 
 // Boids Move
@@ -176,59 +237,120 @@ void Boids::move_boids(float valC, float valA,
 
 // Move one specific boid 
 // idBoid : id of the specific boid to move
+// The rule terms are 3 floats on the stack : nothing is allocated per boid
 void Boids::moveOneBoid(const int idBoid, const float UserValueC, 
 		 const float UserValueV, const float UserValueS, const float UserValueR)
 {
 	// Usual vector
-	std::vector<float> v1;
-	std::vector<float> v2;
-	std::vector<float> v3;
-	std::vector<float> v4;
-	std::vector<float> newVelocity ;
-	std::vector<float> newPosition ;
-	std::vector<float> currentPosition;
+	float v1[3], v2[3], v3[3], v4[3];
+	float newVelocity[3];
+	float newPosition[3];
 
 	// Compute cohesion, alignment and separation
-	v1 = cohesion(idBoid, UserValueC);
-	v2 = align(idBoid, UserValueV);
-	v3 = separation(idBoid, UserValueS);
-	v4 = limiteBox(idBoid, UserValueR);
-	currentPosition = m_group[idBoid].getPosition();
+	cohesion(idBoid, UserValueC, v1);
+	align(idBoid, UserValueV, v2);
+	separation(idBoid, UserValueS, v3);
+	limiteBox(idBoid, UserValueR, v4);
 	
 	for(unsigned int i=0; i<3; ++i)
-		newVelocity.push_back(v1[i] + v2[i] +v3[i]);	
-	for(unsigned int i=0; i<3; ++i)
-		newPosition.push_back(currentPosition[i]+newVelocity[i]);
+	{
+		newVelocity[i] = v1[i] + v2[i] + v3[i];
+		newPosition[i] = m_group[idBoid].position(i) + newVelocity[i];
+	}
 
 	// Update the boid values
 	m_group[idBoid].move(newPosition, newVelocity);
 }
 
-// Compute the initial position for a specific boid
+// Compute the initial position for a specific boid (false : the box is full)
 // idBoid : id of the specific boid to setup
-// sizeBox : size of the box from origin
-void Boids::computeInitialPosition(const int idBoid)
+// Random positions first, then the free cells are tried in order at their
+// corner : a cell rejected once stays rejected (boids are only added), so
+// the whole fallback visits each cell once and always ends
+bool Boids::computeInitialPosition(const int idBoid, PlacementGrid& grid)
 {
-	// Usual position variables
-	float x;
-	float y;
-	float z;
 	// Try new random position while is not good 
-	do
+	// (one random draw per attempt)
+	float random[4];
+	for(unsigned int attempt=0; attempt<MAX_PLACEMENT_ATTEMPTS; ++attempt)
+	{
+		tool_random::uniform4(m_randomKey, tool_random::STREAM_PLACEMENT, idBoid, attempt, random);
+		m_group[idBoid].setPosition(0, c_origin[0]+random[0]*c_sizeBox);
+		m_group[idBoid].setPosition(1, c_origin[1]+random[1]*c_sizeBox);
+		m_group[idBoid].setPosition(2, c_origin[2]+random[2]*c_sizeBox);
+		if(!isIntoVitalSpace(idBoid, grid))
+		{
+			_anchorBoid(grid, _placementCell(grid, m_group[idBoid].position(0), \
+				m_group[idBoid].position(1), m_group[idBoid].position(2)), idBoid);
+			return true;
+		}
+	}
+	// Crowded box : next free cell accepting a boid at its corner
+	const uint64_t nbCells = (uint64_t)grid.nx * grid.ny * grid.nz;
+	for(; grid.nextFreeCell<nbCells; ++grid.nextFreeCell)
 	{
-		x = (float) rand()/RAND_MAX * c_sizeBox;
-		y = (float) rand()/RAND_MAX * c_sizeBox;
-		z = (float) rand()/RAND_MAX * c_sizeBox;
-		m_group[idBoid].setPosition(0, c_origin[0]+x);
-		m_group[idBoid].setPosition(1, c_origin[1]+y);
-		m_group[idBoid].setPosition(2, c_origin[2]+z);
+		const uint64_t cell = grid.nextFreeCell;
+		if(_anchoredBoid(grid, cell) != -1)
+			continue;
+		const int i = cell % grid.nx;
+		const int j = (cell / grid.nx) % grid.ny;
+		const int k = cell / ((uint64_t)grid.nx * grid.ny);
+		m_group[idBoid].setPosition(0, c_origin[0]+i*c_widthOneBoid);
+		m_group[idBoid].setPosition(1, c_origin[1]+j*c_heigthOneBoid);
+		m_group[idBoid].setPosition(2, c_origin[2]+k*c_deepOneBoid);
+		// The cell is found back from the position (rounding may give the previous one)
+		const int64_t anchor = _placementCell(grid, m_group[idBoid].position(0), \
+			m_group[idBoid].position(1), m_group[idBoid].position(2));
+		if(!isIntoVitalSpace(idBoid, grid))
+		{
+			_anchorBoid(grid, anchor, idBoid);
+			++grid.nextFreeCell;
+			return true;
+		}
 	}
-	while( isIntoVitalSpace(idBoid) );
+	return false;
+}
+
+// Placement grid cell of a position (-1 : out of the global box)
+int64_t Boids::_placementCell(const PlacementGrid& grid, const float x, const float y, const float z) const
+{
+	const int i = (int)floor((x - c_origin[0]) / c_widthOneBoid);
+	const int j = (int)floor((y - c_origin[1]) / c_heigthOneBoid);
+	const int k = (int)floor((z - c_origin[2]) / c_deepOneBoid);
+	if(i < 0 || j < 0 || k < 0 || i >= grid.nx || j >= grid.ny || k >= grid.nz)
+		return -1;
+	return i + (int64_t)grid.nx * (j + (int64_t)grid.ny * k);
+}
+
+// Slot of a cell in the placement grid : the slot holding it, else the
+// free slot ending its probe sequence
+static inline uint64_t _placementSlot(const PlacementGrid& grid, const uint64_t cell)
+{
+	uint64_t hash = (cell + 1) * 0x9E3779B97F4A7C15ULL;
+	uint64_t slot = (hash ^ (hash >> 32)) & grid.mask;
+	while(grid.keys[slot] != 0 && grid.keys[slot] != cell + 1)
+		slot = (slot + 1) & grid.mask;
+	return slot;
+}
+
+// Boid anchored in a cell of the placement grid (-1 : none)
+int Boids::_anchoredBoid(const PlacementGrid& grid, const uint64_t cell) const
+{
+	return grid.boids[_placementSlot(grid, cell)];
+}
+
+// Anchor a boid in a free cell of the placement grid
+void Boids::_anchorBoid(PlacementGrid& grid, const uint64_t cell, const int idBoid)
+{
+	const uint64_t slot = _placementSlot(grid, cell);
+	grid.keys[slot] = cell + 1;
+	grid.boids[slot] = idBoid;
 }
 
 // Is one boid into vital space of another one
 // idBoid : id of the specific boid to test
-const bool Boids::isIntoVitalSpace(const int idBoid)
+// Only the boids anchored in the 27 cells around its own can collide
+const bool Boids::isIntoVitalSpace(const int idBoid, const PlacementGrid& grid)
 {
 	// Define two cubic boxes
 	AABB3D b1;
@@ -240,33 +362,40 @@ const bool Boids::isIntoVitalSpace(const int idBoid)
 	b1.w = c_widthOneBoid;
 	b1.h = c_heigthOneBoid;
 	b1.d = c_deepOneBoid;
-	// For each other boids compute box
+	const int64_t cell = _placementCell(grid, b1.x, b1.y, b1.z);
+	// Out of the box (rounding on the far side) : refused
+	if(cell == -1)
+		return true;
+	const int ci = cell % grid.nx;
+	const int cj = (cell / grid.nx) % grid.ny;
+	const int ck = cell / ((int64_t)grid.nx * grid.ny);
+	// For each boid around compute box
 	// and test colision
-	// use an int to avoid warnins on build
-	for(int i = 0; i < idBoid; ++i)
+	for(int k = std::max(ck-1, 0); k <= std::min(ck+1, grid.nz-1); ++k)
+	for(int j = std::max(cj-1, 0); j <= std::min(cj+1, grid.ny-1); ++j)
+	for(int i = std::max(ci-1, 0); i <= std::min(ci+1, grid.nx-1); ++i)
 	{
-		if(i != idBoid)
-		{
-			b2.x = m_group[i].position(0);
-			b2.y = m_group[i].position(1);
-			b2.z = m_group[i].position(2);
-			b2.w = c_widthOneBoid;
-			b2.h = c_heigthOneBoid;
-			b2.d = c_deepOneBoid;
-			
-			if( collision(b1, b2) )
-				return true;
-		}	
+		const int other = _anchoredBoid(grid, i + (uint64_t)grid.nx * (j + (uint64_t)grid.ny * k));
+		if(other == -1 || other == idBoid)
+			continue;
+		b2.x = m_group[other].position(0);
+		b2.y = m_group[other].position(1);
+		b2.z = m_group[other].position(2);
+		b2.w = c_widthOneBoid;
+		b2.h = c_heigthOneBoid;
+		b2.d = c_deepOneBoid;
+		
+		if( collision(b1, b2) )
+			return true;
 	}
 	return false;	
 }
 
 // Compute cohesion (boid closed to each others)
-std::vector<float> Boids::cohesion(const int idBoid, const float UserValueC)
+void Boids::cohesion(const int idBoid, const float UserValueC, float center[3])
 {
-	std::vector<float> center;
 	for(unsigned int i=0; i<3; ++i)
-		center.push_back(0.0f);
+		center[i] = 0.0f;
 	
 	float div = 0.0;	
 	for(unsigned int i=0; i< m_group.size(); ++i)
@@ -284,15 +413,13 @@ std::vector<float> Boids::cohesion(const int idBoid, const float UserValueC)
 		center[i] /= div-1;
 		center[i] = (center[i]-m_group[idBoid].position(i))/UserValueC;
 	}
-	return center;
 }
 
 // Compute separation (boid far to each others)
-std::vector<float> Boids::separation(const int idBoid, const float UserValueS)
+void Boids::separation(const int idBoid, const float UserValueS, float separation[3])
 {
-	std::vector<float> separation;
 	for(unsigned int i=0; i<3; i++)
-		separation.push_back(0.0);
+		separation[i] = 0.0f;
 		
 	for(unsigned int i=0; i< m_group.size(); i++)
 	{
@@ -307,15 +434,13 @@ std::vector<float> Boids::separation(const int idBoid, const float UserValueS)
 			}
 		}
 	}
-	return separation;
 }
 
 // Compute alignement (moderate velocity to each others)
-std::vector<float> Boids::align(const int idBoid, const float UserValueV)
+void Boids::align(const int idBoid, const float UserValueV, float velocity[3])
 {
-	std::vector<float> velocity;
 	for(unsigned int i=0; i<3; ++i)
-		velocity.push_back(0.0);
+		velocity[i] = 0.0f;
 	
 	float div = 0.0;
 	for(unsigned int i=0; i< m_group.size(); ++i)
@@ -334,20 +459,15 @@ std::vector<float> Boids::align(const int idBoid, const float UserValueV)
 		velocity[i] /= div-1;
 		velocity[i] = (velocity[i]-m_group[idBoid].velocite(i))/UserValueV;
 	}
-	return velocity;
 }
 
 // Reduce limit box for a boid
-std::vector<float> Boids::limiteBox(const int idBoid, const float UserValueR)
+void Boids::limiteBox(const int idBoid, const float UserValueR, float decalage[3])
 {
-	
-	std::vector<float> center;
+	// Limits around the world center
+	const float center[3] = { 0.0f, 0.0f, 0.0f };
 	for(unsigned int i=0; i<3; i++)
-		center.push_back(0.0);
-		
-	std::vector<float> decalage;
-	for(unsigned int i=0; i<3; i++)
-		decalage.push_back(0.0);
+		decalage[i] = 0.0f;
 
 	for(unsigned int idx=0; idx<3; ++idx)
 	{
@@ -356,8 +476,6 @@ std::vector<float> Boids::limiteBox(const int idBoid, const float UserValueR)
 		else if(m_group[idBoid].position(idx) > (center[0] + UserValueR))
 			decalage[idx] = -(m_group[idBoid].velocite(idx) * 2);
 	}
-	
-	return decalage;
 }
 
 
@@ -2,6 +2,7 @@
 #define __BOIDS_HPP__
 
 #include <lib3ds.h>
+#include <stdint.h>
 #include <ctime>
 #include <cstdlib>
 #include <iostream>
@@ -19,6 +20,21 @@ struct AABB3D
   float w,h,d;	// box size
 };
 
+// Grid used to place the boids in the global box
+// A cell is the size of one boid box : two boids anchored in the
+// same cell always collide, a cell holds at most one boid
+// Only the anchored cells are stored (hash table sized from the number
+// of boids) : the memory does not depend on the size of the box
+typedef struct
+{
+	int nx, ny, nz;			// number of cells on each axis
+	std::vector<uint64_t> keys;	// cell + 1 held by each slot (0 : free slot)
+	std::vector<int> boids;		// boid anchored in the cell of each slot
+	uint64_t mask;			// slots - 1 (power of two)
+	uint64_t nextFreeCell;		// first cell not tried by the fallback placement
+}
+PlacementGrid;
+
 class Boids : public Figure
 {
 	private :
@@ -37,43 +53,62 @@ class Boids : public Figure
 	std::vector< std::vector<float> > m_leaderPositions; 	// position of the leader boid on time
 
 	public :
+	static const float DEFAULT_SIZE_BOX = 5.0f;	// default global box size
 
 	// Builder
 	// Construct a boids system from nowhere
-	Boids(const int nbUnits, const float sizeBox=5.0f);
-	Boids(const int nbUnits, const std::vector<float> origin, const float sizeBox=5.0f);
+	// randomKey : key of the random numbers of the figure (see tool_random)
+	Boids(const int nbUnits, const float sizeBox=DEFAULT_SIZE_BOX, const uint32_t randomKey=0);
+	Boids(const int nbUnits, const std::vector<float> origin, const float sizeBox=DEFAULT_SIZE_BOX, const uint32_t randomKey=0);
 	// Construct a boids system with an animated leader
-	Boids(const int nbUnits, const std::string filepath, const int start, const int end, const float sizeBox=5.0f);
+	Boids(const int nbUnits, const std::string filepath, const int start, const int end,
+	      const float sizeBox=DEFAULT_SIZE_BOX, const uint32_t randomKey=0);
 	// Construct a boids system from Mesh or something else
+	// The previous figure is left to its owner
 	Boids(Figure* b, const std::string filepath="", const int start=0, const int end=0);
+	// Make the boids system (again) from another figure (see FigurePool)
+	void makeFrom(Figure* b, const std::string filepath="", const int start=0, const int end=0);
 
 	// Move the group (animation)
 	void move_boids(float valC = 40.0, float valA = 10,
 		  float valS = 0.02, float valR = 7.5);
 
 	void move();
+	// Memory - bytes held by the boids system (leader positions : frame cache)
+	MemoryUsage memoryUsage() const;
+	// Pool - a boids system made from another figure is kept for reuse
+	bool recycle(FigurePool& pool);
 	
 	private:
+	// Random positions tried for a boid before the fallback placement
+	static const unsigned int MAX_PLACEMENT_ATTEMPTS = 32;
+
 	// Init boid system
-	void _init(const int nbUnits, const int sizeBox);
+	void _init(const int nbUnits, const float sizeBox);
 	// Read the position information for the leader and build animated parameters
 	void _readLeaderInformation(const std::string filepath, const int start, const int end);
-	// Compute the initial position for a specific boid
-	void computeInitialPosition(const int idBoid);
+	// Compute the initial position for a specific boid (false : the box is full)
+	bool computeInitialPosition(const int idBoid, PlacementGrid& grid);
 	// Is one boid into vital space of another one
-	const bool isIntoVitalSpace(const int idBoid);	
+	const bool isIntoVitalSpace(const int idBoid, const PlacementGrid& grid);
+	// Placement grid cell of a position (-1 : out of the global box)
+	int64_t _placementCell(const PlacementGrid& grid, const float x, const float y, const float z) const;
+	// Boid anchored in a cell of the placement grid (-1 : none)
+	int _anchoredBoid(const PlacementGrid& grid, const uint64_t cell) const;
+	// Anchor a boid in a free cell of the placement grid
+	void _anchorBoid(PlacementGrid& grid, const uint64_t cell, const int idBoid);
 
 	// Move on boid
 	void moveOneBoid(const int idBoid, const float UserValueC, 
 		         const float UserValueV, const float UserValueS, const float UserValueR);
 	// Compute cohesion (boid closed to each others)
-	std::vector<float> cohesion(const int idBoid, const float UserValueC);
+	void cohesion(const int idBoid, const float UserValueC, float center[3]);
 	// Compute separation (boid far to each others)
-	std::vector<float> separation(const int idBoid, const float UserValueS);
+	void separation(const int idBoid, const float UserValueS, float separation[3]);
 	// Compute alignement (moderate velocity to each others)
-	std::vector<float> align(const int idBoid, const float UserValueV);
+	void align(const int idBoid, const float UserValueV, float velocity[3]);
 	// Compute reduction and limit box for a boid
-	std::vector<float> limiteBox(const int idBoid, const float UserValueR);
+	void limiteBox(const int idBoid, const float UserValueR, float decalage[3]);
 };
 
 // Compute colision between 2 cubic boxes	
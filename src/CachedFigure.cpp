@@ -0,0 +1,63 @@
+#include "CachedFigure.hpp"
+
+// Builder
+// Replay an open cache, the figure owns it (the first frame is shown)
+CachedFigure::CachedFigure(ParticleCache* cache, const uint32_t randomKey):
+m_cache(cache),
+m_nextFrame(0)
+{
+	m_type = "PARTICLE_CACHE";
+	m_randomKey = randomKey;
+	m_group.reserve(m_cache->maxBoids());
+	if(m_cache->nbFrames() > 0)
+		_showFrame(0);
+}
+
+CachedFigure::~CachedFigure()
+{
+	delete m_cache;
+}
+
+// Move : show the next frame
+// The recorded frames are the states after each move of the play sequence
+void CachedFigure::move()
+{
+	if(m_nextFrame < m_cache->nbFrames())
+		_showFrame(m_nextFrame++);
+}
+
+// Render - reset the animation parameters (back to the first frame)
+void CachedFigure::reset()
+{
+	Figure::reset();
+	m_nextFrame = 0;
+	if(m_cache->nbFrames() > 0)
+		_showFrame(0);
+}
+
+// Copy a frame of the cache into the group
+// The arrays are read from the mapping : the pages come from the disk once
+void CachedFigure::_showFrame(const unsigned int frame)
+{
+	const unsigned int nbBoids = m_cache->nbBoids(frame);
+	if(m_group.size() > nbBoids)
+		m_group.erase(m_group.begin()+nbBoids, m_group.end());
+	const float* positions = m_cache->positions(frame);
+	const float* intensities = m_cache->intensities(frame);
+	const float* sizes = m_cache->sizes(frame);
+	const uint32_t* ids = m_cache->ids(frame);
+	for(unsigned int i=0; i<nbBoids; ++i)
+	{
+		// Recorded ids : the same LOD keys as the simulated boids
+		if(i == m_group.size())
+			m_group.push_back(Boid(ids[i], m_randomKey));
+		else if((uint32_t)m_group[i].idBoid() != ids[i])
+			m_group[i] = Boid(ids[i], m_randomKey);
+		m_group[i].setPosition(0, positions[3*i]);
+		m_group[i].setPosition(1, positions[3*i+1]);
+		m_group[i].setPosition(2, positions[3*i+2]);
+		m_group[i].setIntensity(intensities[i]);
+		m_group[i].setSize(sizes[i]);
+	}
+	_updateBounds();
+}
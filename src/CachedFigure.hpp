@@ -0,0 +1,40 @@
+#ifndef __CACHEDFIGURE_HPP__
+#define __CACHEDFIGURE_HPP__
+
+#include <vector>
+
+#include "Figure.hpp"
+#include "Boid.hpp"
+#include "ParticleCache.hpp"
+
+// Figure replayed from a particle cache (recorded by a simulated figure)
+// Each move shows the next recorded frame, the last one stays once played
+class CachedFigure : public Figure
+{
+private :
+	ParticleCache * m_cache;			// recorded frames (owned)
+	unsigned int m_nextFrame;			// frame shown by the next move
+
+public :
+	// Builder
+	// Replay an open cache, the figure owns it (the first frame is shown)
+	CachedFigure(ParticleCache* cache, const uint32_t randomKey=0);
+	~CachedFigure();
+
+	// Move : show the next frame
+	void move();
+	// Render - reset the animation parameters (back to the first frame)
+	void reset();
+	// Kept while empty : nothing rebuilds it, it is replayed again by the
+	// next play sequence (see reset)
+	inline bool isNeeded() const { return true; }
+
+private :
+	// Copy a frame of the cache into the group
+	void _showFrame(const unsigned int frame);
+	// Not copyable (owns its cache)
+	CachedFigure(const CachedFigure&);
+	CachedFigure& operator=(const CachedFigure&);
+};
+
+#endif // __CACHEDFIGURE_HPP__
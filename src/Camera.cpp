@@ -28,34 +28,13 @@ m_currentFrame(0)
 void Camera::_init()
 {
 	// Initial position
-	for(unsigned int i=0; i<3; ++i)
-		m_position.push_back(0.0f);
-	m_position[0] = 0.0f;
-	m_position[1] = 0.70f;
-	m_position[2] = 0.0f;
+	m_position = Vec3(0.0f, 0.70f, 0.0f);
 
 	// Initial parameters
 	const float l = 1.0f;
-	std::vector<float> c_aim;
-	std::vector<float> c_up;
-	for(unsigned int i=0; i<3; ++i)
-	{
-		c_aim.push_back(0.0f);
-		c_up.push_back(0.0f);
-
-		m_xAxis.push_back(0.0f);
-		m_yAxis.push_back(0.0f);
-		m_zAxis.push_back(0.0f);
-	}
-	c_up[1] = 1.0f;
+	const Vec3 c_aim;
+	const Vec3 c_up(0.0f, 1.0f, 0.0f);
 
-	//Initialise the matrices
-	for(unsigned int i=0; i<16; ++i)
-	{
-		m_view.push_back(0.0f);
-		m_projection.push_back(0.0f);
-	}
-	
 	// Initial directions
 	m_left = -l;
 	m_right = l;
@@ -71,30 +50,17 @@ void Camera::_init()
 }
 
 // Define the target from an aim vector and an up one
-void Camera::lookAt(const std::vector<float>& aim, const std::vector<float>& up)
+void Camera::lookAt(const Vec3& aim, const Vec3& up)
 {
-	for(unsigned int i=0 ; i<3; ++i)
-	{
-		m_yAxis[i] = up[i];	 		// y axis : up vector
-		m_zAxis[i] = m_position[i] - aim[i]; 	// z axis : from aim to  position
-	}
-
-	// Compute opposite direction of axis z
-	std::vector<float> minusZ;
-	for(unsigned int i=0; i<3; ++i)
-		minusZ.push_back(-1.0f*m_zAxis[i]);
+	m_yAxis = up;	 			// y axis : up vector
+	m_zAxis = m_position - aim; 		// z axis : from aim to  position
 
 	// new Axis x  : from axis y and axis z
-	std::vector<float> newX = tool_geometry::vectorProduct(m_yAxis, m_zAxis);
+	m_xAxis = tool_geometry::vectorProduct(m_yAxis, m_zAxis);
 	// new Axis y  : from new axis x and opposite of axis z
-	std::vector<float> newY = tool_geometry::vectorProduct(newX, minusZ);
+	m_yAxis = tool_geometry::vectorProduct(m_xAxis, -m_zAxis);
 	
-	// Recopy new values and normalize
-	for(unsigned int i=0; i<3; ++i)
-	{
-		m_xAxis[i] = newX[i];
-		m_yAxis[i] = newY[i];
-	}
+	// Normalize
 	tool_geometry::normalize(m_xAxis);
 	tool_geometry::normalize(m_yAxis);
 	tool_geometry::normalize(m_zAxis);
@@ -106,31 +72,17 @@ void Camera::lookAt(const std::vector<float>& aim, const std::vector<float>& up)
 // Updates view matrix from the data
 void Camera::updateView()
 {
-	std::vector<float> c_Rotate;
-	std::vector<float> c_Translate;
-
 	// Rotation to be aligned with correct  axis
-	float Rotate[] = {	m_xAxis[0], m_yAxis[0], m_zAxis[0], 0.0f,
-		     		m_xAxis[1], m_yAxis[1], m_zAxis[1], 0.0f,
-		     		m_xAxis[2], m_yAxis[2], m_zAxis[2], 0.0f,
-		     		0.0f, 	    0.0f, 	0.0f, 	    1.0f
-		         };
+	const float Rotate[] = {	m_xAxis[0], m_yAxis[0], m_zAxis[0], 0.0f,
+			     		m_xAxis[1], m_yAxis[1], m_zAxis[1], 0.0f,
+			     		m_xAxis[2], m_yAxis[2], m_zAxis[2], 0.0f,
+			     		0.0f, 	    0.0f, 	0.0f, 	    1.0f
+			       };
 	// Translation to be at the right distance from the scene
-	float Translate[] = {	1.0f,           0.0f,           0.0f,           0.0f,
-		     		0.0f,           1.0f,           0.0f,           0.0f,
-		    	 	0.0f,           0.0f,           1.0f,           0.0f,
-		     		-m_position[0], -m_position[1], -m_position[2], 1.0f
-			    };
-	// Put information into vector to be used
-	for(unsigned int i=0; i<16; ++i)
-	{
-		c_Rotate.push_back(Rotate[i]);
-		c_Translate.push_back(Translate[i]);
-	}
+	Mat4 c_Translate;
+	tool_geometry::setToTranslate(c_Translate, -m_position);
 
-	tool_geometry::setToIdentity(m_view);
-	tool_geometry::multMatrixBtoMatrixA(m_view, c_Rotate);
-	tool_geometry::multMatrixBtoMatrixA(m_view, c_Translate);
+	m_view = Mat4(Rotate) * c_Translate;
 }
 
 // Updates the projection matrix from the data
@@ -144,14 +96,12 @@ void Camera::updateProjection()
 	const float f = m_far;
 
 	// Perspective projection
-	float P[] = {	(2.0f*n)/(r-l),  0.0f,            0.0f,               0.0f,
-		  	0.0f,            (2.0f*n)/(t-b),  0.0f,               0.0f,
-		 	(r+l)/(r-l),     (t+b)/(t-b),     -(f+n)/(f-n),       -1.0f,
-		  	0.0f,            0.0f,            -(2.0f*f*n)/(f-n),  0.0f
-		    };
-
-	for (unsigned int i=0 ; i<16 ; ++i)
-		m_projection[i] = P[i];
+	const float P[] = {	(2.0f*n)/(r-l),  0.0f,            0.0f,               0.0f,
+			  	0.0f,            (2.0f*n)/(t-b),  0.0f,               0.0f,
+			 	(r+l)/(r-l),     (t+b)/(t-b),     -(f+n)/(f-n),       -1.0f,
+			  	0.0f,            0.0f,            -(2.0f*f*n)/(f-n),  0.0f
+			  };
+	m_projection = Mat4(P);
 }
 
 // Adjust the perspective (Fovy and image ratio)
@@ -210,9 +160,15 @@ float* Camera::getProjectionf(float* projection)
 	return projection;
 }	
 
+// Get the view frustum in world space (OpenGL)
+Frustum Camera::frustum() const
+{
+	return Frustum(m_projection * m_view);
+}
+
 // Get/set
 // View matrix
-std::vector<float>& Camera::view()
+Mat4& Camera::view()
 {
 	return m_view;
 }
@@ -255,7 +211,15 @@ void Camera::setZAxis(const int i, const float value)
 	m_zAxis[i] = value;
 }
 // Camera mode
-const std::string Camera::getMode() const
+const std::string& Camera::getMode() const
 {
 	return m_cameraMode;
 }
+
+// Memory - bytes held by the camera path (views of each frame)
+MemoryUsage Camera::memoryUsage() const
+{
+	MemoryUsage usage;
+	usage.frameCache = tool_memory::bytes(m_views) + tool_memory::bytes(m_rendermanViews);
+	return usage;
+}
@@ -4,14 +4,17 @@
 #include <vector>
 #include <string>
 
+#include "Matrix.hpp"
+#include "Memory.hpp"
+
 class Camera
 {
 private :
 	// Usual
-	std::vector<float> m_position; 	// Camera position
-        std::vector<float> m_xAxis; 	// Camera axis x : right side
-        std::vector<float> m_yAxis; 	// Camera axis y : up
-        std::vector<float> m_zAxis; 	// Camera axis z : backward
+	Vec3 m_position; 		// Camera position
+        Vec3 m_xAxis; 			// Camera axis x : right side
+        Vec3 m_yAxis; 			// Camera axis y : up
+        Vec3 m_zAxis; 			// Camera axis z : backward
 
 	// Frustrum parameters
         float m_left; 			// x coord from center to left plane of frustum
@@ -22,17 +25,17 @@ private :
         float m_far;			// far (frustrum value)	
 
 	// Matrices
-        std::vector<float> m_view;	// view matrix
-        std::vector<float> m_projection;// projection matrix
+        Mat4 m_view;			// view matrix
+        Mat4 m_projection;		// projection matrix
 
 	// Animation parameters
 	// It is easier to keep the camera mode 
 	// as the global play mode for the Application
 	std::string m_cameraMode;				// FPS or PLAY
 	unsigned int m_currentFrame;				// current frame displayed on screen (default 0)
-	std::vector< std::vector<float> > m_views; 		// view matrixes from 3ds files sequence
-	std::vector<float> m_rendermanView;			// current transform matrix (renderman)
-	std::vector< std::vector<float> > m_rendermanViews; 	// transform matrix from 3ds file sequence (renderman)
+	std::vector<Mat4> m_views; 				// view matrixes from 3ds files sequence
+	Mat4 m_rendermanView;					// current transform matrix (renderman)
+	std::vector<Mat4> m_rendermanViews; 			// transform matrix from 3ds file sequence (renderman)
 
 public :
 	// Builder
@@ -47,7 +50,7 @@ public :
 	// Change camera perspective
         void setPerspectiveFromAngle(const float fovy=0.75, const float aspectRatio=1.777);
 	// Update the camera target
-        void lookAt(const std::vector<float>& aim, const std::vector<float>& up);
+        void lookAt(const Vec3& aim, const Vec3& up);
 
 	// Animate the Camera from 3ds file sequence
 	// Switch camera to PLAY mode (will automatically go back to FPS at the end)
@@ -60,13 +63,19 @@ public :
 	float* getViewf(float* modelView);
 	float* getProjectionf(float* projection);
 	// Get current renderman transform 
-	inline std::vector<float> getRendermanTransform() const { return m_rendermanView; }
+	inline const Mat4& getRendermanTransform() const { return m_rendermanView; }
+	// Get the view frustum in world space (OpenGL)
+	Frustum frustum() const;
+	// Get the tangent of half the vertical fov (OpenGL)
+	inline float tanHalfFov() const { return m_top / m_near; }
+	// Memory - bytes held by the camera path (views of each frame)
+	MemoryUsage memoryUsage() const;
 	
 	// Get/set
 	// Camera mode
-	const std::string getMode() const;
+	const std::string& getMode() const;
 	// View matrix
-	std::vector<float>& view();
+	Mat4& view();
 	// Position
 	const float position(const int i) const;
 	void setPosition(const int i, const float value);
@@ -1,42 +1,118 @@
 #include "Explosion.hpp"
+#include "WorkerPool.hpp"
+#include "FigurePool.hpp"
 
 #include <math.h>
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 Explosion::Explosion()
 {
 	m_type = "EXPLOSION";
+	_setup(defaultSettings());
 }
 
 // Make an explosion from other Figures
-//@WARNING: Destroy the previous figure
-Explosion::Explosion(Figure* b)
+// The previous figure is left to its owner
+Explosion::Explosion(Figure* b, const ExplosionSettings& settings)
 {
+	makeFrom(b, settings);
+}
+
+// Make the explosion (again) from another figure
+// A reused explosion keeps the capacity of its buffers
+void Explosion::makeFrom(Figure* b, const ExplosionSettings& settings)
+{
+	_clearFigure();
+	m_origins.clear();
+	m_x.clear();
+	m_y.clear();
+	m_z.clear();
+	m_intensities.clear();
 	m_type = "EXPLOSION_FROM_" + b->type();
+	m_transient = true;
+	// Keep the placement, LOD and random key of the previous figure
+	_inheritSettings(b);
 	// Copy the group
+	m_group.reserve(b->size());
 	for(int i=0; i<b->size(); ++i)
 	{
-		Boid newBoid(i);
+		Boid newBoid(i, m_randomKey);
 		for(unsigned int idx=0; idx<3; ++idx)
 			newBoid.setPosition(idx, b->getBoid(i).position(idx));
 		newBoid.setIntensity(b->getBoid(i).intensity());
 		m_group.push_back(newBoid);
+		m_x.push_back(newBoid.position(0));
+		m_y.push_back(newBoid.position(1));
+		m_z.push_back(newBoid.position(2));
+		m_intensities.push_back(newBoid.intensity());
 	}
 	// Compute the explosion origin
-	_computeCenter();
-	free(b);
+	if(settings.origins.empty())
+		_computeCenter();
+	_setup(settings);
+	// Each boid is pushed by the impact nearest to it at the blast
+	m_originOf.resize(m_group.size());
+	WorkerPool::shared().run(_assignOriginsTask, this, m_group.size(), KERNEL_GRAIN);
+	_updateBounds();
 }
 
 // Move the group (animation)
+// The faded boids are removed first, the kernel moves the others
+// on the worker threads by ranges of KERNEL_GRAIN boids
 void Explosion::move()
 {
-	//@WARNING: use an int cause loop in reverse order
-	for(int i=m_group.size()-1; i>=0; --i)
-	{	
-		if( m_group[i].intensity() > 0.0f)
-			_moveOneBoid(i);
-		else
-			m_group.erase(m_group.begin()+i);	
+	_compact();
+	WorkerPool::shared().run(_moveRangeTask, this, m_group.size(), KERNEL_GRAIN);
+	_updateBounds();
+}
+
+// Remove the faded boids, keeps the order (group and contiguous copy)
+// One pass : the alive boids are packed to the front (the culling chunks
+// stay compact), the faded ones are removed at once
+void Explosion::_compact()
+{
+	unsigned int nbAlive = 0;
+	for(unsigned int i=0; i<m_group.size(); ++i)
+	{
+		if(m_intensities[i] > 0.0f)
+		{
+			if(nbAlive != i)
+			{
+				m_group[nbAlive] = m_group[i];
+				m_x[nbAlive] = m_x[i];
+				m_y[nbAlive] = m_y[i];
+				m_z[nbAlive] = m_z[i];
+				m_intensities[nbAlive] = m_intensities[i];
+				m_originOf[nbAlive] = m_originOf[i];
+			}
+			++nbAlive;
+		}
 	}
+	m_group.erase(m_group.begin()+nbAlive, m_group.end());
+	m_x.resize(nbAlive);
+	m_y.resize(nbAlive);
+	m_z.resize(nbAlive);
+	m_intensities.resize(nbAlive);
+	m_originOf.resize(nbAlive);
+}
+
+// Memory - bytes held by the explosion (contiguous copy included)
+MemoryUsage Explosion::memoryUsage() const
+{
+	MemoryUsage usage = Figure::memoryUsage();
+	usage.particles += tool_memory::bytes(m_x) + tool_memory::bytes(m_y) + tool_memory::bytes(m_z) \
+		+ tool_memory::bytes(m_intensities) + tool_memory::bytes(m_originOf);
+	usage.scratch += tool_memory::bytes(m_falloffTable) + tool_memory::bytes(m_origins) + m_originTree.memoryBytes();
+	return usage;
+}
+
+// Pool - an explosion made from another figure is kept for reuse
+bool Explosion::recycle(FigurePool& pool)
+{
+	return m_transient && pool.keep(this);
 }
 
 // Compute origin of explosion
@@ -53,51 +129,152 @@ void Explosion::_computeCenter()
 		z += m_group[i].position(2);
 	}
 
-	m_origin.push_back((float)(x/m_group.size()));
-	m_origin.push_back((float)(y/m_group.size()));
-	m_origin.push_back((float)(z/m_group.size()));
+	m_origins.push_back(Vec3(x/m_group.size(), y/m_group.size(), z/m_group.size()));
+}
+
+// Default shape : one impact at the center of the group
+// Falloff steps (distance : factor) 0 : 7, 0.5 : 6, 1 : 5, 2 : 3.5, 3 : 2, 6 : 0.5
+ExplosionSettings Explosion::defaultSettings()
+{
+	static const FalloffPoint DEFAULT_FALLOFF[] = { \
+		{ 0.0f, 7.0f },		// on impact
+		{ 0.5f, 6.0f },		// very close from impact
+		{ 1.0f, 5.0f },		// close from impact
+		{ 2.0f, 3.5f },		// far from impact
+		{ 3.0f, 2.0f },		// affected by impact
+		{ 6.0f, 0.5f }		// not so affected by impact
+	};
+	ExplosionSettings settings;
+	settings.falloff.assign(DEFAULT_FALLOFF, DEFAULT_FALLOFF + 6);
+	settings.linearFalloff = false;
+	settings.speed = 0.007f;
+	settings.fade = 0.001f;
+	return settings;
+}
+
+// Sample the falloff curve and index the origins
+// The table covers the distances up to the last control point, the
+// farther boids use its factor
+void Explosion::_setup(const ExplosionSettings& settings)
+{
+	m_fade = settings.fade;
+	m_origins.insert(m_origins.end(), settings.origins.begin(), settings.origins.end());
+	if(m_origins.empty())
+		m_origins.push_back(Vec3());
+	m_originTree.build(m_origins);
+
+	const std::vector<FalloffPoint>& points = settings.falloff;
+	const float lastDistance = points.empty() ? 0.0f : points.back().distance;
+	m_falloffScale = (lastDistance > 0.0f) ? (FALLOFF_SAMPLES - 1) / lastDistance : 0.0f;
+	// Whole samples per unit : the steps at round distances start on a sample
+	if(m_falloffScale > 1.0f)
+		m_falloffScale = floor(m_falloffScale);
+	m_falloffTable.assign(FALLOFF_SAMPLES, points.empty() ? 1.0f : points.back().factor);
+	for(unsigned int sample=0; sample+1<FALLOFF_SAMPLES && m_falloffScale > 0.0f; ++sample)
+	{
+		const float distance = sample / m_falloffScale;
+		unsigned int next = 0;
+		while(next < points.size() && points[next].distance <= distance)
+			++next;
+		if(next == 0)
+			m_falloffTable[sample] = points[0].factor;
+		else if(!settings.linearFalloff || next == points.size())
+			m_falloffTable[sample] = points[next-1].factor;
+		else
+		{
+			const FalloffPoint& a = points[next-1];
+			const FalloffPoint& b = points[next];
+			const float t = (distance - a.distance) / (b.distance - a.distance);
+			m_falloffTable[sample] = a.factor + (b.factor - a.factor) * t;
+		}
+	}
+	for(unsigned int sample=0; sample<FALLOFF_SAMPLES; ++sample)
+		m_falloffTable[sample] *= settings.speed;
+}
+
+// Kernel - parallel range entry point
+void Explosion::_moveRangeTask(void* explosion, const unsigned int begin, const unsigned int end)
+{
+	((Explosion*)explosion)->_moveRange(begin, end);
 }
 
-// Move one boid
-void Explosion::_moveOneBoid(const int idBoid)
+// Origins - parallel range entry point
+void Explosion::_assignOriginsTask(void* explosion, const unsigned int begin, const unsigned int end)
 {
-	// Compute distance from origin
-	float norm = 0.0f;
-	std::vector<float> distOrigin;
-	for(unsigned int i=0; i<3; ++i)
+	((Explosion*)explosion)->_assignOrigins(begin, end);
+}
+
+// Give the boids [begin, end) their nearest origin
+void Explosion::_assignOrigins(const unsigned int begin, const unsigned int end)
+{
+	for(unsigned int i=begin; i<end; ++i)
+		m_originOf[i] = m_originTree.nearest(Vec3(m_x[i], m_y[i], m_z[i]));
+}
+
+// Kernel - move the boids [begin, end) and copy them back to the group
+// Each boid goes away from its origin by the sampled falloff of its
+// distance, and fades slower when it moves faster.
+void Explosion::_moveRange(const unsigned int begin, const unsigned int end)
+{
+	const float* table = &m_falloffTable[0];
+	const float lastSample = (float)(FALLOFF_SAMPLES - 1);
+	unsigned int i = begin;
+#ifdef __SSE2__
+	// 4 boids at a time, 1/sqrt from rsqrt refined by one Newton step
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 threeHalves = _mm_set1_ps(1.5f);
+	const __m128 scale = _mm_set1_ps(m_falloffScale);
+	const __m128 last = _mm_set1_ps(lastSample);
+	const __m128 fade = _mm_set1_ps(m_fade);
+	int sample[4];
+	for(; i+4<=end; i+=4)
+	{
+		const Vec3& o0 = m_origins[m_originOf[i]];
+		const Vec3& o1 = m_origins[m_originOf[i+1]];
+		const Vec3& o2 = m_origins[m_originOf[i+2]];
+		const Vec3& o3 = m_origins[m_originOf[i+3]];
+		const __m128 dx = _mm_sub_ps(_mm_loadu_ps(&m_x[i]), _mm_setr_ps(o0.x, o1.x, o2.x, o3.x));
+		const __m128 dy = _mm_sub_ps(_mm_loadu_ps(&m_y[i]), _mm_setr_ps(o0.y, o1.y, o2.y, o3.y));
+		const __m128 dz = _mm_sub_ps(_mm_loadu_ps(&m_z[i]), _mm_setr_ps(o0.z, o1.z, o2.z, o3.z));
+		const __m128 norm2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		__m128 invNorm = _mm_rsqrt_ps(norm2);
+		invNorm = _mm_mul_ps(invNorm, _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(half, norm2), _mm_mul_ps(invNorm, invNorm))));
+		// A boid on its origin has no direction : it does not move
+		invNorm = _mm_and_ps(invNorm, _mm_cmpgt_ps(norm2, zero));
+		const __m128 norm = _mm_mul_ps(norm2, invNorm);
+		// Falloff lookup
+		_mm_storeu_si128((__m128i*)sample, _mm_cvttps_epi32(_mm_min_ps(_mm_mul_ps(norm, scale), last)));
+		const __m128 factor = _mm_setr_ps(table[sample[0]], table[sample[1]], table[sample[2]], table[sample[3]]);
+		const __m128 step = _mm_mul_ps(invNorm, factor);
+		_mm_storeu_ps(&m_x[i], _mm_add_ps(_mm_loadu_ps(&m_x[i]), _mm_mul_ps(dx, step)));
+		_mm_storeu_ps(&m_y[i], _mm_add_ps(_mm_loadu_ps(&m_y[i]), _mm_mul_ps(dy, step)));
+		_mm_storeu_ps(&m_z[i], _mm_add_ps(_mm_loadu_ps(&m_z[i]), _mm_mul_ps(dz, step)));
+		_mm_storeu_ps(&m_intensities[i], _mm_sub_ps(_mm_loadu_ps(&m_intensities[i]), _mm_div_ps(fade, factor)));
+	}
+#endif
+	// Remaining boids (all of them without SSE2)
+	for(; i<end; ++i)
 	{
-		distOrigin.push_back(m_group[idBoid].position(i)-m_origin[i]);
-		norm += pow(distOrigin[i],2);
+		const Vec3& origin = m_origins[m_originOf[i]];
+		const float dx = m_x[i] - origin.x;
+		const float dy = m_y[i] - origin.y;
+		const float dz = m_z[i] - origin.z;
+		const float norm2 = dx*dx + dy*dy + dz*dz;
+		const float invNorm = (norm2 > 0.0f) ? 1.0f / sqrtf(norm2) : 0.0f;
+		const float factor = table[(int)std::min(norm2 * invNorm * m_falloffScale, lastSample)];
+		const float step = invNorm * factor;
+		m_x[i] += dx * step;
+		m_y[i] += dy * step;
+		m_z[i] += dz * step;
+		m_intensities[i] -= m_fade / factor;
 	}
-	norm = sqrt(norm);
-	for(unsigned int i=0; i<3; ++i)
-		distOrigin[i] /= norm;
-
-	// Work on norm as percentage
-	norm/= 100.0;
-	float explFactor = 0.0f;
-
-	if(norm < 0.005)			// on impact
-		explFactor = 7.0f;
-	else if(norm < 0.01)			// very close from impact
-		explFactor = 6.0f;
-	else if(norm < 0.02)			// close from impact
-		explFactor = 5.0f;
-	else if(norm < 0.03)			// far from impact
-		explFactor = 3.5f;
-	else if(norm < 0.06)			// affected by impact
-		explFactor = 2.0f;
-	else					// not so affected by impact
- 		explFactor = 0.5f;
-
-	explFactor *= EXPLOSION_RANDOM;
-	// Compute new position
-	for(unsigned int idx=0; idx<3; ++idx)
+	// Copy back to the group (drawn and rendered from it)
+	for(i=begin; i<end; ++i)
 	{
-		float newValue = m_group[idBoid].position(idx)+(distOrigin[idx]*explFactor);
-		m_group[idBoid].setPosition(idx,newValue);
+		m_group[i].setPosition(0, m_x[i]);
+		m_group[i].setPosition(1, m_y[i]);
+		m_group[i].setPosition(2, m_z[i]);
+		m_group[i].setIntensity(m_intensities[i]);
 	}
-	// Update intensity
-	float updateIntensity = 1.0f/explFactor * EXPLOSION_INTENSITY;
-	m_group[idBoid].setIntensity(m_group[idBoid].intensity()-updateIntensity);
 }
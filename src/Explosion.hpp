@@ -8,13 +8,43 @@
 
 #include "Figure.hpp"
 #include "Boid.hpp"
+#include "PointTree.hpp"
+
+// Control point of the explosion falloff : boids at this distance
+// of their origin move by factor * speed at each step
+typedef struct
+{
+	float distance;				// distance to the origin (object space)
+	float factor;				// move factor (> 0)
+}
+FalloffPoint;
+
+// Shape of an explosion (<explosion> node of a figure)
+typedef struct
+{
+	std::vector<FalloffPoint> falloff;	// control points, sorted by distance
+	bool linearFalloff;			// interpolate the points (false : steps)
+	float speed;				// move scale
+	float fade;				// intensity lost at each step, divided by the move
+	std::vector<Vec3> origins;		// impacts, object space (none : center of the group)
+}
+ExplosionSettings;
 
 class Explosion : public Figure
 {
 private :
-	std::vector<float> m_origin;			// origin of the explosion
-	const static float EXPLOSION_RANDOM = 0.007f;	// affects position
-	const static float EXPLOSION_INTENSITY = 0.001f;// affects intensity change
+	std::vector<Vec3> m_origins;			// origins of the explosion
+	PointTree m_originTree;				// nearest origin of the boids
+	// Falloff curve sampled once (move of a boid at a distance, speed included)
+	static const unsigned int FALLOFF_SAMPLES = 1024;
+	std::vector<float> m_falloffTable;		// FALLOFF_SAMPLES moves
+	float m_falloffScale;				// samples per distance unit
+	float m_fade;					// intensity lost at each step (see ExplosionSettings)
+	// Contiguous copy of the group moved by the kernel (same order as m_group)
+	std::vector<float> m_x, m_y, m_z;		// positions
+	std::vector<float> m_intensities;		// intensities
+	std::vector<unsigned int> m_originOf;		// origin pushing each boid (nearest at the blast)
+	static const unsigned int KERNEL_GRAIN = 4096;	// boids per parallel range
 
 public :
 	// Builder
@@ -22,17 +52,36 @@ public :
 	Explosion();
 
 	// Make an explosion from other Figures
-	//@WARNING: Destroy the previous figure
-	Explosion(Figure* b);
+	// The previous figure is left to its owner
+	Explosion(Figure* b, const ExplosionSettings& settings=defaultSettings());
+	// Make the explosion (again) from another figure (see FigurePool)
+	void makeFrom(Figure* b, const ExplosionSettings& settings=defaultSettings());
+
+	// Default shape : one impact at the center of the group
+	static ExplosionSettings defaultSettings();
 
 	// Move the group (animation)
 	void move();
+	// Memory - bytes held by the explosion (contiguous copy included)
+	MemoryUsage memoryUsage() const;
+	// Pool - an explosion made from another figure is kept for reuse
+	bool recycle(FigurePool& pool);
 	
 private:
 	// Compute origin of explosion
 	void _computeCenter();
-	// Move one boid
-	void _moveOneBoid(const int idBoid);
+	// Sample the falloff curve and index the origins
+	void _setup(const ExplosionSettings& settings);
+	// Remove the faded boids, keeps the order (group and contiguous copy)
+	void _compact();
+	// Kernel - move the boids [begin, end) and copy them back to the group
+	void _moveRange(const unsigned int begin, const unsigned int end);
+	// Kernel - parallel range entry point
+	static void _moveRangeTask(void* explosion, const unsigned int begin, const unsigned int end);
+	// Give the boids [begin, end) their nearest origin
+	void _assignOrigins(const unsigned int begin, const unsigned int end);
+	// Origins - parallel range entry point
+	static void _assignOriginsTask(void* explosion, const unsigned int begin, const unsigned int end);
 };
 
 #endif // __EXPLOSION_HPP__
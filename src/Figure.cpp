@@ -1,59 +1,288 @@
 #include "Figure.hpp"
 #include "Tools.hpp"
 
-#include <ri.h>
-#include <GL/gl.h>
-#include <GL/glu.h>
+#include <algorithm>
 
 // Builder
 Figure::Figure():
-m_renderFrame(0)
+m_renderFrame(0),
+m_maxBoidSize(0.0f),
+m_lodDensity(0.0f),
+m_randomKey(0),
+m_recorder(NULL),
+m_transient(false)
 {
 	m_type = "ABSTRACT_FIGURE"; 				
 }
 
+Figure::~Figure() {}
+
+// Pool - give the figure to the pool for reuse (false : not kept, the caller deletes it)
+// The figures of the scene file are rebuilt from their files
+bool Figure::recycle(FigurePool& pool)
+{
+	return false;
+}
+
 void Figure::move() {}
 
-//Draw function OpenGL
-void Figure::brutalDraw()
+// Draw - gather the points to draw (only the chunks inside the world space frustum)
+// points : x, y, z, size, intensity per boid (PointRenderer layout)
+void Figure::drawPoints(std::vector<float>& points, const Frustum& frustum, const float lodRatio) const
+{
+	points.clear();
+	for(unsigned int chunk=0; chunk<m_chunkBounds.size(); ++chunk)
+	{
+		if(!_isChunkVisible(chunk, frustum))
+			continue;
+		const unsigned int end = std::min((unsigned int)m_group.size(), (chunk+1)*CHUNK_SIZE);
+		for(unsigned int i=chunk*CHUNK_SIZE; i<end; ++i)
+		{
+			if(!_lodKeep(i, lodRatio))
+				continue;
+			points.push_back(m_group[i].position(0));
+			points.push_back(m_group[i].position(1));
+			points.push_back(m_group[i].position(2));
+			points.push_back(m_group[i].size());
+			points.push_back(m_group[i].intensity());
+		}
+	}
+}
+
+// Culling - test the figure against a world space frustum
+bool Figure::isVisible(const Frustum& frustum, const float margin) const
+{
+	return frustum.intersects(transformBox(m_transform, m_bounds).padded(margin));
+}
+
+// Culling - test one chunk against a world space frustum
+bool Figure::_isChunkVisible(const unsigned int chunk, const Frustum& frustum, const float margin) const
+{
+	return frustum.intersects(transformBox(m_transform, m_chunkBounds[chunk]).padded(margin));
+}
+
+// Culling - compute the boxes of the group and its chunks
+// One pass on the positions, called at the end of each move()
+void Figure::_updateBounds()
 {
-	std::cout << "brutal Draw - "<< m_type << "(" << \
-				m_group.size() <<")"<< std::endl;
+	const unsigned int nbChunks = (m_group.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	m_bounds = Box();
+	m_chunkBounds.assign(nbChunks, Box());
+	m_maxBoidSize = 0.0f;
 	for(unsigned int i=0; i<m_group.size(); ++i)
 	{
-		float x = m_group[i].position(0);
-		float y = m_group[i].position(1);
-		float z = m_group[i].position(2);
-		
-		glVertex3d(x,y,z);
+		const Vec3 p(m_group[i].position(0), m_group[i].position(1), m_group[i].position(2));
+		m_chunkBounds[i/CHUNK_SIZE].extend(p);
+		if(m_group[i].size() > m_maxBoidSize)
+			m_maxBoidSize = m_group[i].size();
+	}
+	for(unsigned int chunk=0; chunk<nbChunks; ++chunk)
+	{
+		if(m_chunkBounds[chunk].isEmpty())
+			continue;
+		m_bounds.extend(m_chunkBounds[chunk].min);
+		m_bounds.extend(m_chunkBounds[chunk].max);
 	}
 }
 
 // Render - set render camera
-void Figure::setRenderCamera(const std::vector<float>& camera)
+void Figure::setRenderCamera(const Mat4& camera)
 {
-	m_cameraMatrix.clear();
-	for(unsigned int i=0; i<16; ++i)
-		m_cameraMatrix.push_back(camera[i]);
+	m_cameraMatrix = camera;
 }
 
 // Render - reset the animation parameters
 void Figure::reset()
 {
 	m_renderFrame = 0;
-	m_cameraMatrix.clear();
+	m_cameraMatrix = Mat4();
+	updateTransform(0);
 }
 
-// Render - functions RenderMan
-void Figure::render()
+// Helper : order the placement keys by frame
+static bool _keyBefore(const TransformKey& a, const TransformKey& b)
 {
-	std::string figureName = m_type + "_" + m_name;
-	tool_renderman::generateRIBHeader(figureName, m_renderFrame, m_cameraMatrix);
-	// Render specific for figures
-	RiWorldBegin();
-	for(unsigned int i=0; i<m_group.size(); ++i)
-		tool_renderman::renderOneBoid(m_group[i]);
-	tool_renderman::generateRIBFileFooter();
-	++m_renderFrame;
+	return a.frame < b.frame;
 }
 
+// Transform - set the placement keys (the placement goes to the first key)
+void Figure::setTransformKeys(const std::vector<TransformKey>& keys)
+{
+	m_transformKeys = keys;
+	std::stable_sort(m_transformKeys.begin(), m_transformKeys.end(), _keyBefore);
+	updateTransform(0);
+}
+
+// Transform - interpolate the placement at a play frame
+// Values are linear between two keys and held before the first / after the last
+void Figure::updateTransform(const unsigned int frame)
+{
+	if(m_transformKeys.empty())
+	{
+		m_transform = Mat4();
+		return;
+	}
+	unsigned int next = 0;
+	while(next < m_transformKeys.size() && m_transformKeys[next].frame <= frame)
+		++next;
+	const TransformKey& a = m_transformKeys[(next == 0) ? 0 : next-1];
+	const TransformKey& b = m_transformKeys[(next == m_transformKeys.size()) ? next-1 : next];
+	float t = 0.0f;
+	if(b.frame > a.frame)
+		t = (float)(frame - a.frame) / (float)(b.frame - a.frame);
+
+	const Vec3 translate = a.translate + (b.translate - a.translate) * t;
+	const Vec3 rotate = (a.rotate + (b.rotate - a.rotate) * t) * (float)(M_PI / 180.0);
+	const Vec3 scale = a.scale + (b.scale - a.scale) * t;
+
+	Mat4 T, RX, RY, RZ, S;
+	tool_geometry::setToTranslate(T, translate);
+	tool_geometry::setToRotate(RX, rotate.x, Vec3(1.0f, 0.0f, 0.0f));
+	tool_geometry::setToRotate(RY, rotate.y, Vec3(0.0f, 1.0f, 0.0f));
+	tool_geometry::setToRotate(RZ, rotate.z, Vec3(0.0f, 0.0f, 1.0f));
+	tool_geometry::setToScale(S, scale);
+	m_transform = T * RZ * RY * RX * S;
+}
+
+// Back to an empty figure for reuse (the buffers keep their capacity)
+void Figure::_clearFigure()
+{
+	m_group.clear();
+	m_name.clear();
+	m_transformKeys.clear();
+	m_transform = Mat4();
+	m_cameraMatrix = Mat4();
+	m_renderFrame = 0;
+	m_bounds = Box();
+	m_chunkBounds.clear();
+	m_maxBoidSize = 0.0f;
+	m_lodDensity = 0.0f;
+	m_randomKey = 0;
+	m_recorder = NULL;
+}
+
+// Keep the placement, LOD, random key and recorder of the figure this one is made from
+// (a recording goes on through the explosion of a boids system)
+void Figure::_inheritSettings(const Figure* b)
+{
+	m_transformKeys = b->transformKeys();
+	m_transform = b->transform();
+	m_lodDensity = b->lodDensity();
+	m_randomKey = b->randomKey();
+	m_recorder = b->recorder();
+}
+
+// LOD - part of the boids to keep for a camera (1 : all of them)
+// The screen density is the number of boids over the projected
+// footprint of the figure, kept under m_lodDensity boids per screen
+float Figure::lodRatio(const Mat4& view, const float tanHalfFov) const
+{
+	if(m_lodDensity <= 0.0f || m_group.empty() || m_bounds.isEmpty())
+		return 1.0f;
+	const Box world = transformBox(m_transform, m_bounds);
+	const Vec3 center = (world.min + world.max) * 0.5f;
+	const Vec3 halfSize = (world.max - world.min) * 0.5f;
+	const Vec3 fromCamera = transformPoint(view, center);
+	const float distance = sqrt(dot(fromCamera, fromCamera));
+	const float radius = sqrt(dot(halfSize, halfSize));
+	// Part of the screen covered by the figure
+	float footprint = 1.0f;
+	if(distance > radius)
+		footprint = std::min(1.0f, (radius*radius) / (distance*distance*tanHalfFov*tanHalfFov));
+	const float ratio = m_lodDensity * footprint / (float)m_group.size();
+	// Always keep at least one boid
+	return std::max(std::min(ratio, 1.0f), 1.0f / (float)m_group.size());
+}
+
+// LOD - scales keeping the look of the decimated group (bigger, brighter boids)
+// The covered area is kept by the radius, up to LOD_MAX_GROWTH, then by the intensity
+void Figure::lodCompensation(const float lodRatio, float& radiusScale, float& intensityScale)
+{
+	const float LOD_MAX_GROWTH = 4.0f;
+	radiusScale = std::min(1.0f / (float)sqrt(lodRatio), LOD_MAX_GROWTH);
+	intensityScale = 1.0f / (lodRatio * radiusScale * radiusScale);
+}
+
+// LOD - is the boid kept at this ratio (same boids from one frame to the next)
+// The boid id is hashed to a key in [0,1) : a lower ratio keeps a subset
+bool Figure::_lodKeep(const unsigned int i, const float lodRatio) const
+{
+	if(lodRatio >= 1.0f)
+		return true;
+	uint32_t key = (uint32_t)m_group[i].idBoid();
+	key = (key ^ 61) ^ (key >> 16);
+	key *= 9;
+	key = key ^ (key >> 4);
+	key *= 0x27d4eb2d;
+	key = key ^ (key >> 15);
+	return (key / 4294967296.0f) < lodRatio;
+}
+
+// Memory - bytes held by the figure
+// The group is the particle state, the culling boxes and keys are kept between frames
+MemoryUsage Figure::memoryUsage() const
+{
+	MemoryUsage usage;
+	usage.particles = tool_memory::bytes(m_group);
+	usage.scratch = tool_memory::bytes(m_chunkBounds) + tool_memory::bytes(m_transformKeys);
+	return usage;
+}
+
+// Cache - write the boids of the current frame to the recorder (if any)
+void Figure::record()
+{
+	if(m_recorder != NULL)
+		m_recorder->writeFrame(m_group);
+}
+
+// Render - copy the data needed by the RIB files of the current frame
+void Figure::snapshot(RenderJob& job) const
+{
+	job.name = m_type + "_" + m_name;
+	job.frame = m_renderFrame;
+	job.camera = m_cameraMatrix;
+	job.transform = m_transform;
+	job.isMesh = false;
+	job.geometryHash = 0;
+	// Distant boids are decimated, the kept ones grow to keep the look
+	const float ratio = lodRatio(m_cameraMatrix, tool_renderman::cameraTanHalfFov());
+	float intensityScale = 1.0f;
+	lodCompensation(ratio, job.radiusScale, intensityScale);
+	// Only the chunks seen by the render camera are exported
+	const Frustum frustum = tool_renderman::cameraFrustum(m_cameraMatrix);
+	const float margin = tool_renderman::boidRadius(m_maxBoidSize) * job.radiusScale;
+	job.visible = isVisible(frustum, margin);
+	// Buffers keep their capacity from the previous use of the job
+	job.positions.resize(3*m_group.size());
+	job.sizes.resize(m_group.size());
+	job.intensities.resize(m_group.size());
+	unsigned int nbBoids = 0;
+	for(unsigned int chunk=0; job.visible && chunk<m_chunkBounds.size(); ++chunk)
+	{
+		if(!_isChunkVisible(chunk, frustum, margin))
+			continue;
+		const unsigned int end = std::min((unsigned int)m_group.size(), (chunk+1)*CHUNK_SIZE);
+		for(unsigned int i=chunk*CHUNK_SIZE; i<end; ++i)
+		{
+			if(!_lodKeep(i, ratio))
+				continue;
+			for(unsigned int idx=0; idx<3; ++idx)
+				job.positions[3*nbBoids+idx] = m_group[i].position(idx);
+			job.sizes[nbBoids] = m_group[i].size();
+			job.intensities[nbBoids] = std::min(m_group[i].intensity() * intensityScale, 1.0f);
+			++nbBoids;
+		}
+	}
+	job.positions.resize(3*nbBoids);
+	job.sizes.resize(nbBoids);
+	job.intensities.resize(nbBoids);
+}
+
+// Render - functions RenderMan (written by the queue writers)
+void Figure::render(RenderQueue& queue)
+{
+	RenderJob* job = queue.acquire();
+	snapshot(*job);
+	queue.push(job);
+	++m_renderFrame;
+}
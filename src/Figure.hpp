@@ -8,6 +8,23 @@
 #include <string>
 
 #include "Boid.hpp"
+#include "Matrix.hpp"
+#include "RenderQueue.hpp"
+#include "Memory.hpp"
+#include "ParticleCache.hpp"
+
+// Placement of a figure at a key frame of the play sequence
+// Applied as translate * rotateZ * rotateY * rotateX * scale
+typedef struct
+{
+	unsigned int frame;			// play frame of the key
+	Vec3 translate;				// translation
+	Vec3 rotate;				// rotation around X, Y and Z (degrees)
+	Vec3 scale;				// scale on X, Y and Z
+}
+TransformKey;
+
+class FigurePool;
 
 // Abstract class for Figure (explosion, Boids..)
 // Defines the main function to overwrite by the new Process
@@ -19,30 +36,88 @@ protected :
 	std::string m_type; 				// Type of the figure 
 	std::string m_name;				// Name of the figure
 	//Animated parameters
-	std::vector<float> m_cameraMatrix;		// Store the camera matrix for Renderman
+	std::vector<TransformKey> m_transformKeys;	// Placement keys, sorted by frame
+	Mat4 m_transform;				// Current placement (object to world)
+	Mat4 m_cameraMatrix;				// Store the camera matrix for Renderman
 	unsigned int m_renderFrame;			// Current render frame 
+	// Culling (object space boxes, updated by move())
+	static const unsigned int CHUNK_SIZE = 256;	// Boids per culling chunk
+	Box m_bounds;					// Box of the whole group
+	std::vector<Box> m_chunkBounds;			// Box of each chunk of CHUNK_SIZE boids
+	float m_maxBoidSize;				// Largest boid size (renderman sphere margin)
+	// Level of detail
+	float m_lodDensity;				// Boids kept when the figure fills the screen (0 : no LOD)
+	// Random numbers (see tool_random)
+	uint32_t m_randomKey;				// key of the figure, kept by the figures made from it
+	// Particle cache
+	ParticleCacheWriter * m_recorder;		// records each play frame (not owned, NULL : none)
+	// Lifetime
+	bool m_transient;				// made from another figure during play (see FigurePool)
 
 public :
 	// Usual
 	inline Boid getBoid(const int i) { return m_group[i]; }
 	inline const int size() const { return m_group.size(); }
-	inline const bool isNeeded() const { return m_group.size() > 0 ; }
+	// An empty figure is removed from the scene (see CachedFigure)
+	virtual bool isNeeded() const { return m_group.size() > 0 ; }
 	inline const std::string type() const { return m_type; }
 	inline void setName(const std::string name){ m_name = name; }
 	inline const std::string name() const { return m_name; }
+	inline const Mat4& transform() const { return m_transform; }
+	inline const std::vector<TransformKey>& transformKeys() const { return m_transformKeys; }
+	inline void setLodDensity(const float density) { m_lodDensity = density; }
+	inline float lodDensity() const { return m_lodDensity; }
+	inline uint32_t randomKey() const { return m_randomKey; }
+	inline void setRecorder(ParticleCacheWriter* recorder) { m_recorder = recorder; }
+	inline ParticleCacheWriter* recorder() const { return m_recorder; }
 
 	// Builder
 	Figure();
+	virtual ~Figure();
 	// Animate the Figure
 	virtual void move();
-	// Draw - function OpenGL
-	void brutalDraw();
-	// Render - functions RenderMan
-	virtual void render();
+	// Draw - gather the points to draw (only the chunks inside the world space frustum)
+	// points : x, y, z, size, intensity per boid (PointRenderer layout)
+	// lodRatio : part of the boids to draw (see lodRatio())
+	void drawPoints(std::vector<float>& points, const Frustum& frustum, const float lodRatio=1.0f) const;
+	// Culling - test the figure against a world space frustum
+	// margin : grows the world box of the figure on every side
+	bool isVisible(const Frustum& frustum, const float margin=0.0f) const;
+	// Render - copy the data needed by the RIB files of the current frame
+	virtual void snapshot(RenderJob& job) const;
+	// Render - functions RenderMan (written by the queue writers)
+	void render(RenderQueue& queue);
 	// Render - set render camera
-	void setRenderCamera(const std::vector<float>& camera);
+	void setRenderCamera(const Mat4& camera);
 	// Render - reset the animation parameters
-	void reset();
+	virtual void reset();
+	// Transform - set the placement keys (the placement goes to the first key)
+	void setTransformKeys(const std::vector<TransformKey>& keys);
+	// Transform - interpolate the placement at a play frame
+	void updateTransform(const unsigned int frame);
+	// LOD - part of the boids to keep for a camera (1 : all of them)
+	// view : world to camera transform, tanHalfFov : tangent of half the smaller fov
+	float lodRatio(const Mat4& view, const float tanHalfFov) const;
+	// LOD - scales keeping the look of the decimated group (bigger, brighter boids)
+	static void lodCompensation(const float lodRatio, float& radiusScale, float& intensityScale);
+	// Memory - bytes held by the figure
+	virtual MemoryUsage memoryUsage() const;
+	// Cache - write the boids of the current frame to the recorder (if any)
+	void record();
+	// Pool - give the figure to the pool for reuse (false : not kept, the caller deletes it)
+	virtual bool recycle(FigurePool& pool);
+
+protected :
+	// Back to an empty figure for reuse (the buffers keep their capacity)
+	void _clearFigure();
+	// Keep the placement, LOD, random key and recorder of the figure this one is made from
+	void _inheritSettings(const Figure* b);
+	// Culling - compute the boxes of the group and its chunks
+	void _updateBounds();
+	// LOD - is the boid kept at this ratio (same boids from one frame to the next)
+	bool _lodKeep(const unsigned int i, const float lodRatio) const;
+	// Culling - test one chunk against a world space frustum
+	bool _isChunkVisible(const unsigned int chunk, const Frustum& frustum, const float margin=0.0f) const;
 };
 
 #endif // __FIGURE_HPP__
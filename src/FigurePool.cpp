@@ -0,0 +1,83 @@
+#include "FigurePool.hpp"
+
+// Builder
+FigurePool::FigurePool()
+{
+}
+
+FigurePool::~FigurePool()
+{
+	clear();
+}
+
+// Make an explosion from a figure (a released one is reused)
+Explosion* FigurePool::explosion(Figure* from, const ExplosionSettings& settings)
+{
+	if(m_explosions.empty())
+		return new Explosion(from, settings);
+	Explosion* explosion = m_explosions.back();
+	m_explosions.pop_back();
+	explosion->makeFrom(from, settings);
+	return explosion;
+}
+
+// Make a boids system from a figure (a released one is reused)
+Boids* FigurePool::boids(Figure* from, const std::string filepath, const int start, const int end)
+{
+	if(m_boids.empty())
+		return new Boids(from, filepath, start, end);
+	Boids* boids = m_boids.back();
+	m_boids.pop_back();
+	boids->makeFrom(from, filepath, start, end);
+	return boids;
+}
+
+// Give back a figure removed from the scene (NULL : nothing done)
+// The figure tells if it is transient (see Figure::recycle)
+void FigurePool::release(Figure* figure)
+{
+	if(figure == NULL)
+		return;
+	if(!figure->recycle(*this))
+		delete figure;
+}
+
+// Keep a released explosion for reuse (false : the pool is full)
+bool FigurePool::keep(Explosion* explosion)
+{
+	if(m_explosions.size() >= MAX_POOLED)
+		return false;
+	m_explosions.push_back(explosion);
+	return true;
+}
+
+// Keep a released boids system for reuse (false : the pool is full)
+bool FigurePool::keep(Boids* boids)
+{
+	if(m_boids.size() >= MAX_POOLED)
+		return false;
+	m_boids.push_back(boids);
+	return true;
+}
+
+// Delete the kept figures
+void FigurePool::clear()
+{
+	for(unsigned int i=0; i<m_explosions.size(); ++i)
+		delete m_explosions[i];
+	for(unsigned int i=0; i<m_boids.size(); ++i)
+		delete m_boids[i];
+	m_explosions.clear();
+	m_boids.clear();
+}
+
+// Memory - bytes held by the kept figures
+MemoryUsage FigurePool::memoryUsage() const
+{
+	MemoryUsage usage;
+	for(unsigned int i=0; i<m_explosions.size(); ++i)
+		usage += m_explosions[i]->memoryUsage();
+	for(unsigned int i=0; i<m_boids.size(); ++i)
+		usage += m_boids[i]->memoryUsage();
+	return usage;
+}
@@ -0,0 +1,50 @@
+// Lifetime of the figures of the scene : a figure removed from the
+// scene is released here. The transient ones (explosions and boids
+// systems made from another figure during play) are kept for the next
+// play sequence, with the capacity of their buffers.
+
+#ifndef __FIGUREPOOL_HPP__
+#define __FIGUREPOOL_HPP__
+
+#include <string>
+#include <vector>
+
+#include "Figure.hpp"
+#include "Explosion.hpp"
+#include "Boids.hpp"
+
+class FigurePool
+{
+private :
+	std::vector<Explosion*> m_explosions;		// released explosions, ready for reuse
+	std::vector<Boids*> m_boids;			// released boids systems, ready for reuse
+	static const unsigned int MAX_POOLED = 32;	// kept figures of each type (the others are deleted)
+
+public :
+	// Builder
+	FigurePool();
+	~FigurePool();
+
+	// Make an explosion from a figure (a released one is reused)
+	// The figure is left to the caller
+	Explosion* explosion(Figure* from, const ExplosionSettings& settings);
+	// Make a boids system from a figure (a released one is reused)
+	// The figure is left to the caller
+	Boids* boids(Figure* from, const std::string filepath="", const int start=0, const int end=0);
+	// Give back a figure removed from the scene (NULL : nothing done)
+	// Transient figures are kept for reuse, the others are deleted
+	void release(Figure* figure);
+	// Keep a released figure for reuse (false : the pool is full)
+	// Called by the figures (see Figure::recycle)
+	bool keep(Explosion* explosion);
+	bool keep(Boids* boids);
+	// Delete the kept figures
+	void clear();
+
+	// Usual
+	inline unsigned int nbPooled() const { return m_explosions.size() + m_boids.size(); }
+	// Memory - bytes held by the kept figures
+	MemoryUsage memoryUsage() const;
+};
+
+#endif // __FIGUREPOOL_HPP__
@@ -0,0 +1,169 @@
+#include "FrameArena.hpp"
+
+#include <SDL.h>
+#include <cstdlib>
+#include <algorithm>
+
+// Arena of each thread, and every arena made (for the reports)
+static __thread FrameArena * s_local = NULL;
+static std::vector<FrameArena*> s_arenas;
+static SDL_mutex * s_arenasMutex = NULL;	// arenas list and published usages (see init)
+
+// Builder
+FrameArena::FrameArena(const unsigned long threadId):
+m_offset(0),
+m_capacity(0),
+m_used(0),
+m_threadId(threadId)
+{
+	m_stats.capacity = 0;
+	m_stats.used = 0;
+	m_stats.peak = 0;
+	m_stats.nbSystemAllocs = 0;
+	m_stats.lastGrowthFrame = 0;
+	m_stats.nbResets = 0;
+	m_blocks.reserve(8);
+}
+
+FrameArena::~FrameArena()
+{
+	for(unsigned int i=0; i<m_blocks.size(); ++i)
+		free(m_blocks[i].data);
+}
+
+// Get size bytes (16 bytes aligned), valid until reset()
+void* FrameArena::allocate(const size_t size)
+{
+	const size_t aligned = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+	if(m_blocks.empty() || m_offset + aligned > m_blocks.back().size)
+		_grow(aligned);
+	void* buffer = m_blocks.back().data + m_offset;
+	m_offset += aligned;
+	m_used += aligned;
+	return buffer;
+}
+
+// End of the frame : every buffer handed out is given back
+// The blocks of a frame which grew are merged, the next one fits in one
+void FrameArena::reset()
+{
+	if(m_blocks.size() > 1)
+	{
+		for(unsigned int i=0; i<m_blocks.size(); ++i)
+			free(m_blocks[i].data);
+		m_blocks.clear();
+		const size_t capacity = m_capacity;
+		m_capacity = 0;
+		_grow(capacity);
+	}
+	m_offset = 0;
+	SDL_LockMutex(s_arenasMutex);
+	m_stats.used = m_used;
+	m_stats.peak = std::max(m_stats.peak, m_stats.used);
+	++m_stats.nbResets;
+	SDL_UnlockMutex(s_arenasMutex);
+	m_used = 0;
+}
+
+// Start a new block holding at least size bytes
+// Blocks double : a frame asks the system a few times at most
+void FrameArena::_grow(const size_t size)
+{
+	Block block;
+	block.size = std::max(std::max(size, m_capacity), MIN_BLOCK_SIZE);
+	// malloc : aligned for any type (16 bytes on x86-64)
+	block.data = (char*)malloc(block.size);
+	if(block.data == NULL)
+	{
+		std::cout << "Error: frame arena out of memory (" << block.size << " bytes)" << std::endl;
+		exit(2);
+	}
+	m_blocks.push_back(block);
+	m_offset = 0;
+	m_capacity += block.size;
+	SDL_LockMutex(s_arenasMutex);
+	m_stats.capacity = m_capacity;
+	++m_stats.nbSystemAllocs;
+	m_stats.lastGrowthFrame = m_stats.nbResets;
+	SDL_UnlockMutex(s_arenasMutex);
+}
+
+// Usage published by the owner thread
+ArenaStats FrameArena::stats() const
+{
+	SDL_LockMutex(s_arenasMutex);
+	const ArenaStats stats = m_stats;
+	SDL_UnlockMutex(s_arenasMutex);
+	return stats;
+}
+
+// Make the lock of the arenas (after SDL_Init, before any thread uses one)
+void FrameArena::init()
+{
+	if(s_arenasMutex == NULL)
+		s_arenasMutex = SDL_CreateMutex();
+}
+
+// Arena of the calling thread (made on first use)
+FrameArena& FrameArena::local()
+{
+	if(s_local == NULL)
+	{
+		if(s_arenasMutex == NULL)
+		{
+			std::cout << "Error: frame arena used before FrameArena::init()" << std::endl;
+			exit(2);
+		}
+		s_local = new FrameArena(SDL_ThreadID());
+		SDL_LockMutex(s_arenasMutex);
+		s_arenas.push_back(s_local);
+		SDL_UnlockMutex(s_arenasMutex);
+	}
+	return *s_local;
+}
+
+// Print the usage of every arena
+// In steady state the last growth stays behind the frames count
+void FrameArena::report(std::ostream& out)
+{
+	SDL_LockMutex(s_arenasMutex);
+	unsigned long capacity = 0;
+	out << "Frame arenas :" << std::endl;
+	for(unsigned int i=0; i<s_arenas.size(); ++i)
+	{
+		// Lock held : the usage is read as published
+		const ArenaStats& stats = s_arenas[i]->m_stats;
+		out << "  thread " << s_arenas[i]->threadId() \
+		    << " - capacity : " << stats.capacity / 1024 << " KB" \
+		    << " - peak : " << stats.peak / 1024 << " KB" \
+		    << " - system allocations : " << stats.nbSystemAllocs \
+		    << " (last at frame " << stats.lastGrowthFrame << " of " << stats.nbResets << ")" << std::endl;
+		capacity += stats.capacity;
+	}
+	out << "  total capacity : " << capacity / 1024 << " KB" << std::endl;
+	SDL_UnlockMutex(s_arenasMutex);
+}
+
+// Bytes reserved by every arena
+size_t FrameArena::totalCapacity()
+{
+	size_t capacity = 0;
+	SDL_LockMutex(s_arenasMutex);
+	for(unsigned int i=0; i<s_arenas.size(); ++i)
+		capacity += s_arenas[i]->m_stats.capacity;
+	SDL_UnlockMutex(s_arenasMutex);
+	return capacity;
+}
+
+// Free every arena and the lock (the threads using them must be ended)
+void FrameArena::releaseAll()
+{
+	if(s_arenasMutex == NULL)
+		return;
+	for(unsigned int i=0; i<s_arenas.size(); ++i)
+		delete s_arenas[i];
+	s_arenas.clear();
+	s_local = NULL;
+	SDL_DestroyMutex(s_arenasMutex);
+	s_arenasMutex = NULL;
+}
@@ -0,0 +1,82 @@
+// Per-frame scratch memory : a linear arena hands out buffers which live
+// until its thread ends the frame (or the job) with reset(). Each thread
+// has its own arena, no lock is taken to allocate : the usage read by the
+// reports is published under a lock when a block is asked or a frame ends.
+
+#ifndef __FRAMEARENA_HPP__
+#define __FRAMEARENA_HPP__
+
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+// Usage of an arena
+typedef struct
+{
+	unsigned long capacity;		// bytes reserved
+	unsigned long used;		// bytes handed out in the last frame ended
+	unsigned long peak;		// most bytes handed out in one frame
+	unsigned int nbSystemAllocs;	// blocks asked to the system
+	unsigned int lastGrowthFrame;	// frame of the last block asked (none after in steady state)
+	unsigned int nbResets;		// frames ended
+}
+ArenaStats;
+
+class FrameArena
+{
+private :
+	// Memory block, the buffers are taken from the last one
+	typedef struct
+	{
+		char * data;
+		size_t size;
+	}
+	Block;
+	std::vector<Block> m_blocks;			// blocks of the frame (one in steady state)
+	size_t m_offset;				// first free byte of the last block
+	size_t m_capacity;				// bytes reserved (owner thread)
+	size_t m_used;					// bytes handed out since the last reset (owner thread)
+	ArenaStats m_stats;				// published usage (arenas lock)
+	unsigned long m_threadId;			// owner thread (reports)
+	static const size_t MIN_BLOCK_SIZE = 64*1024;	// first block
+	static const size_t ALIGNMENT = 16;		// SSE loads
+
+public :
+	// Builder
+	FrameArena(const unsigned long threadId);
+	~FrameArena();
+
+	// Get size bytes (16 bytes aligned), valid until reset()
+	void* allocate(const size_t size);
+	// Get an array of n values, not initialized (plain types only)
+	template<typename T>
+	inline T* alloc(const size_t n) { return (T*)allocate(n * sizeof(T)); }
+	// End of the frame : every buffer handed out is given back
+	// The blocks of a frame which grew are merged, the next one fits in one
+	void reset();
+
+	// Usual
+	inline unsigned long threadId() const { return m_threadId; }
+	// Usage published by the owner thread
+	ArenaStats stats() const;
+
+	// Make the lock of the arenas (after SDL_Init, before any thread uses one)
+	static void init();
+	// Arena of the calling thread (made on first use)
+	static FrameArena& local();
+	// Print the usage of every arena
+	static void report(std::ostream& out);
+	// Bytes reserved by every arena
+	static size_t totalCapacity();
+	// Free every arena and the lock (the threads using them must be ended)
+	static void releaseAll();
+
+private :
+	// Start a new block holding at least size bytes
+	void _grow(const size_t size);
+	// Not copyable (owns its blocks)
+	FrameArena(const FrameArena&);
+	FrameArena& operator=(const FrameArena&);
+};
+
+#endif // __FRAMEARENA_HPP__
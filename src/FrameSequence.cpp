@@ -0,0 +1,178 @@
+#include "FrameSequence.hpp"
+#include "Memory.hpp"
+
+#include <string.h>
+
+// Helpers : signed differences on a variable length (7 bits per byte,
+// the high bit tells a byte follows), small values of both signs first
+static inline void _writeDelta(std::vector<unsigned char>& out, const int delta)
+{
+	uint32_t value = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+	while(value >= 0x80)
+	{
+		out.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((unsigned char)value);
+}
+
+static inline int _readDelta(const unsigned char*& in)
+{
+	uint32_t value = 0;
+	unsigned int shift = 0;
+	while(*in & 0x80)
+	{
+		value |= (uint32_t)(*in++ & 0x7F) << shift;
+		shift += 7;
+	}
+	value |= (uint32_t)(*in++) << shift;
+	return (int)(value >> 1) ^ -(int)(value & 1);
+}
+
+// Builder
+FrameSequence::FrameSequence(const FrameStorage storage):
+m_storage(storage),
+m_decodedFrame(-1)
+{
+}
+
+// Add a frame at the end (points : nbPoints x,y,z)
+void FrameSequence::push(const float* points, const unsigned int nbPoints)
+{
+	m_frames.push_back(CodedFrame());
+	CodedFrame& frame = m_frames.back();
+	const unsigned int index = m_frames.size() - 1;
+	const unsigned int nbValues = 3 * nbPoints;
+	frame.nbPoints = nbPoints;
+	frame.isKey = true;
+	m_encoded.clear();
+	if(m_storage == FRAMES_FLOAT)
+	{
+		m_encoded.resize(nbValues * sizeof(float));
+		if(nbValues > 0)
+			memcpy(&m_encoded[0], points, nbValues * sizeof(float));
+	}
+	else
+	{
+		std::vector<uint16_t> codes;
+		_quantize(points, frame, codes);
+		// Delta : same points as the previous frame, and not a key frame
+		if(m_storage == FRAMES_DELTA && index % KEY_FRAME_INTERVAL != 0 && m_frames[index-1].nbPoints == nbPoints)
+			frame.isKey = false;
+		if(frame.isKey)
+		{
+			m_encoded.resize(nbValues * sizeof(uint16_t));
+			if(nbValues > 0)
+				memcpy(&m_encoded[0], &codes[0], nbValues * sizeof(uint16_t));
+		}
+		else
+		{
+			for(unsigned int i=0; i<nbValues; ++i)
+				_writeDelta(m_encoded, (int)codes[i] - (int)m_previousCodes[i]);
+		}
+		m_previousCodes.swap(codes);
+	}
+	// Exact size : the frames are never changed
+	frame.data.assign(m_encoded.begin(), m_encoded.end());
+	m_decodedFrame = -1;
+}
+
+// Loading done : the encoder buffers are released
+void FrameSequence::endLoading()
+{
+	std::vector<uint16_t>().swap(m_previousCodes);
+	std::vector<unsigned char>().swap(m_encoded);
+}
+
+// Decode a frame (points : room for nbPoints(frame) x,y,z)
+// The next frame is the fastest to decode after this one
+void FrameSequence::decode(const unsigned int frame, float* points) const
+{
+	const CodedFrame& coded = m_frames[frame];
+	const unsigned int nbValues = 3 * coded.nbPoints;
+	if(nbValues == 0)
+		return;
+	if(m_storage == FRAMES_FLOAT)
+	{
+		memcpy(points, &coded.data[0], nbValues * sizeof(float));
+		return;
+	}
+	if(m_storage == FRAMES_QUANTIZED)
+	{
+		_readCodes(coded, m_decodedCodes);
+		m_decodedFrame = frame;
+	}
+	else if(m_decodedFrame != (int)frame)
+	{
+		// Go on from the last decoded frame when it leads to this one,
+		// else from the key frame before it
+		unsigned int key = frame;
+		while(!m_frames[key].isKey)
+			--key;
+		unsigned int next = key + 1;
+		if(m_decodedFrame >= (int)key && m_decodedFrame < (int)frame)
+			next = m_decodedFrame + 1;
+		else
+			_readCodes(m_frames[key], m_decodedCodes);
+		for(; next<=frame; ++next)
+			_applyDeltas(m_frames[next], m_decodedCodes);
+		m_decodedFrame = frame;
+	}
+	for(unsigned int i=0; i<nbValues; i+=3)
+	{
+		points[i] = coded.min.x + m_decodedCodes[i] * coded.step.x;
+		points[i+1] = coded.min.y + m_decodedCodes[i+1] * coded.step.y;
+		points[i+2] = coded.min.z + m_decodedCodes[i+2] * coded.step.z;
+	}
+}
+
+// Bytes held by the frames (and the decoder)
+size_t FrameSequence::memoryBytes() const
+{
+	size_t total = tool_memory::bytes(m_frames) + tool_memory::bytes(m_decodedCodes) \
+		+ tool_memory::bytes(m_previousCodes) + tool_memory::bytes(m_encoded);
+	for(unsigned int i=0; i<m_frames.size(); ++i)
+		total += tool_memory::bytes(m_frames[i].data);
+	return total;
+}
+
+// Quantize the points of a frame in its box
+// A flat axis has a null step : all of its codes are 0
+void FrameSequence::_quantize(const float* points, CodedFrame& frame, std::vector<uint16_t>& codes) const
+{
+	const unsigned int nbValues = 3 * frame.nbPoints;
+	Box box;
+	for(unsigned int i=0; i<nbValues; i+=3)
+		box.extend(Vec3(points[i], points[i+1], points[i+2]));
+	frame.min = box.isEmpty() ? Vec3() : box.min;
+	for(unsigned int axis=0; axis<3; ++axis)
+	{
+		const float extent = box.isEmpty() ? 0.0f : box.max[axis] - box.min[axis];
+		frame.step[axis] = (extent > 0.0f) ? extent / 65535.0f : 0.0f;
+	}
+	codes.resize(nbValues);
+	for(unsigned int i=0; i<nbValues; ++i)
+	{
+		const unsigned int axis = i % 3;
+		float code = 0.0f;
+		if(frame.step[axis] > 0.0f)
+			code = (points[i] - frame.min[axis]) / frame.step[axis] + 0.5f;
+		codes[i] = (uint16_t)std::min(std::max(code, 0.0f), 65535.0f);
+	}
+}
+
+// Codes of a quantized or key frame
+void FrameSequence::_readCodes(const CodedFrame& frame, std::vector<uint16_t>& codes) const
+{
+	codes.resize(3 * frame.nbPoints);
+	if(!codes.empty())
+		memcpy(&codes[0], &frame.data[0], codes.size() * sizeof(uint16_t));
+}
+
+// Add the differences of a delta frame to the codes of the previous one
+void FrameSequence::_applyDeltas(const CodedFrame& frame, std::vector<uint16_t>& codes) const
+{
+	const unsigned char* in = frame.data.empty() ? NULL : &frame.data[0];
+	for(unsigned int i=0; i<codes.size(); ++i)
+		codes[i] = (uint16_t)(codes[i] + _readDelta(in));
+}
@@ -0,0 +1,78 @@
+// Frames of an animated set of points (x,y,z per point) kept compressed
+// in memory and decoded on access.
+// Quantized frames store 16 bits per coordinate in the box of the frame
+// (error : half a step, box size / 131070). Delta frames store the
+// difference of these codes to the previous frame on a variable length
+// (1 byte for the small moves), a key frame every KEY_FRAME_INTERVAL
+// frames bounds the decoding of a random access.
+
+#ifndef __FRAMESEQUENCE_HPP__
+#define __FRAMESEQUENCE_HPP__
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+#include "Matrix.hpp"
+
+// Storage of the frames (<mesh frameStorage="">)
+enum FrameStorage
+{
+	FRAMES_FLOAT,		// full precision, no compression
+	FRAMES_QUANTIZED,	// 16 bits per coordinate
+	FRAMES_DELTA		// 16 bits per coordinate, difference to the previous frame
+};
+
+class FrameSequence
+{
+private :
+	// One coded frame
+	typedef struct
+	{
+		unsigned int nbPoints;			// number of points (x,y,z)
+		Vec3 min;				// box of the frame
+		Vec3 step;				// quantization step on each axis
+		bool isKey;				// decoded alone (delta : from the previous frame otherwise)
+		std::vector<unsigned char> data;	// coded values
+	}
+	CodedFrame;
+
+	FrameStorage m_storage;
+	std::vector<CodedFrame> m_frames;
+	std::vector<uint16_t> m_previousCodes;		// encoder : codes of the last pushed frame
+	std::vector<unsigned char> m_encoded;		// encoder : values of the frame being coded
+	// Decoder (delta) : the decoding of the next frame goes on from the last one
+	mutable int m_decodedFrame;			// frame of the codes below (-1 : none)
+	mutable std::vector<uint16_t> m_decodedCodes;
+	static const unsigned int KEY_FRAME_INTERVAL = 32;
+
+public :
+	// Builder
+	FrameSequence(const FrameStorage storage=FRAMES_QUANTIZED);
+
+	// Add a frame at the end (points : nbPoints x,y,z)
+	void push(const float* points, const unsigned int nbPoints);
+	// Loading done : the encoder buffers are released
+	void endLoading();
+	// Decode a frame (points : room for nbPoints(frame) x,y,z)
+	// The next frame is the fastest to decode after this one
+	void decode(const unsigned int frame, float* points) const;
+
+	// Usual
+	inline unsigned int size() const { return m_frames.size(); }
+	inline unsigned int nbPoints(const unsigned int frame) const { return m_frames[frame].nbPoints; }
+	inline FrameStorage storage() const { return m_storage; }
+	inline void reserve(const unsigned int nbFrames) { m_frames.reserve(nbFrames); }
+	// Bytes held by the frames (and the decoder)
+	size_t memoryBytes() const;
+
+private :
+	// Quantize the points of a frame in its box
+	void _quantize(const float* points, CodedFrame& frame, std::vector<uint16_t>& codes) const;
+	// Codes of a quantized or key frame
+	void _readCodes(const CodedFrame& frame, std::vector<uint16_t>& codes) const;
+	// Add the differences of a delta frame to the codes of the previous one
+	void _applyDeltas(const CodedFrame& frame, std::vector<uint16_t>& codes) const;
+};
+
+#endif // __FRAMESEQUENCE_HPP__
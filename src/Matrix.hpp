@@ -0,0 +1,166 @@
+// Fixed size vector and matrix value types, bounding boxes and frustums
+// No heap allocation : can be used per particle.
+// Matrices are described column-major, as OpenGL expects them.
+
+#ifndef __MATRIX_HPP__
+#define __MATRIX_HPP__
+
+#include <cfloat>
+#include <cmath>
+
+struct Vec3
+{
+	float x, y, z;
+
+	// Builder
+	Vec3() : x(0.0f), y(0.0f), z(0.0f) {}
+	Vec3(const float vx, const float vy, const float vz) : x(vx), y(vy), z(vz) {}
+
+	// Access by index (0:x, 1:y, 2:z)
+	inline float& operator[](const int i) { return (&x)[i]; }
+	inline float operator[](const int i) const { return (&x)[i]; }
+};
+
+inline Vec3 operator+(const Vec3& a, const Vec3& b) { return Vec3(a.x+b.x, a.y+b.y, a.z+b.z); }
+inline Vec3 operator-(const Vec3& a, const Vec3& b) { return Vec3(a.x-b.x, a.y-b.y, a.z-b.z); }
+inline Vec3 operator-(const Vec3& a) { return Vec3(-a.x, -a.y, -a.z); }
+inline Vec3 operator*(const Vec3& a, const float s) { return Vec3(a.x*s, a.y*s, a.z*s); }
+inline float dot(const Vec3& a, const Vec3& b) { return a.x*b.x + a.y*b.y + a.z*b.z; }
+inline Vec3 cross(const Vec3& a, const Vec3& b)
+{
+	return Vec3(a.y*b.z - a.z*b.y, a.z*b.x - a.x*b.z, a.x*b.y - a.y*b.x);
+}
+
+// 16 bytes aligned so a column fits a SSE register
+struct __attribute__((aligned(16))) Mat4
+{
+	float m[16];
+
+	// Builder : identity
+	Mat4()
+	{
+		for(unsigned int i=0; i<16; ++i)
+			m[i] = (i%5 == 0) ? 1.0f : 0.0f;
+	}
+	// Builder : copy 16 column-major values
+	explicit Mat4(const float* values)
+	{
+		for(unsigned int i=0; i<16; ++i)
+			m[i] = values[i];
+	}
+
+	// Access by index (column*4 + row)
+	inline float& operator[](const int i) { return m[i]; }
+	inline float operator[](const int i) const { return m[i]; }
+	inline const float* data() const { return m; }
+};
+
+// Matrix product : column j of the result is A * (column j of B)
+inline Mat4 operator*(const Mat4& a, const Mat4& b)
+{
+	Mat4 r;
+	for(unsigned int j=0; j<4; ++j)
+	{
+		for(unsigned int i=0; i<4; ++i)
+			r.m[j*4+i] = a.m[i]*b.m[j*4] + a.m[4+i]*b.m[j*4+1] \
+				   + a.m[8+i]*b.m[j*4+2] + a.m[12+i]*b.m[j*4+3];
+	}
+	return r;
+}
+
+// Transform a point (w = 1)
+inline Vec3 transformPoint(const Mat4& a, const Vec3& p)
+{
+	return Vec3(a.m[0]*p.x + a.m[4]*p.y + a.m[8]*p.z + a.m[12],
+		    a.m[1]*p.x + a.m[5]*p.y + a.m[9]*p.z + a.m[13],
+		    a.m[2]*p.x + a.m[6]*p.y + a.m[10]*p.z + a.m[14]);
+}
+
+// Axis aligned bounding box (empty when min > max)
+struct Box
+{
+	Vec3 min, max;
+
+	// Builder : empty box
+	Box() : min(FLT_MAX, FLT_MAX, FLT_MAX), max(-FLT_MAX, -FLT_MAX, -FLT_MAX) {}
+
+	// Usual
+	inline bool isEmpty() const { return min.x > max.x; }
+	// Grow the box to contain p
+	inline void extend(const Vec3& p)
+	{
+		for(unsigned int i=0; i<3; ++i)
+		{
+			if(p[i] < min[i]) min[i] = p[i];
+			if(p[i] > max[i]) max[i] = p[i];
+		}
+	}
+	// Grow the box by margin on every side
+	inline Box padded(const float margin) const
+	{
+		Box box;
+		if(!isEmpty())
+		{
+			box.min = min - Vec3(margin, margin, margin);
+			box.max = max + Vec3(margin, margin, margin);
+		}
+		return box;
+	}
+};
+
+// Box containing the transformed box (Arvo)
+inline Box transformBox(const Mat4& a, const Box& box)
+{
+	if(box.isEmpty())
+		return box;
+	Box r;
+	for(unsigned int i=0; i<3; ++i)
+	{
+		r.min[i] = r.max[i] = a.m[12+i];
+		for(unsigned int j=0; j<3; ++j)
+		{
+			const float e = a.m[j*4+i] * box.min[j];
+			const float f = a.m[j*4+i] * box.max[j];
+			r.min[i] += (e < f) ? e : f;
+			r.max[i] += (e < f) ? f : e;
+		}
+	}
+	return r;
+}
+
+// View frustum : 6 planes (a,b,c,d), inside when a*x+b*y+c*z+d >= 0
+struct Frustum
+{
+	float planes[6][4];
+
+	// Builder : planes of a projection * view matrix (Gribb-Hartmann)
+	explicit Frustum(const Mat4& viewProjection)
+	{
+		for(unsigned int p=0; p<6; ++p)
+		{
+			const unsigned int row = p/2;
+			const float sign = (p%2 == 0) ? 1.0f : -1.0f;
+			for(unsigned int j=0; j<4; ++j)
+				planes[p][j] = viewProjection.m[j*4+3] + sign*viewProjection.m[j*4+row];
+		}
+	}
+
+	// false only if the box is fully outside one of the planes
+	inline bool intersects(const Box& box) const
+	{
+		if(box.isEmpty())
+			return false;
+		for(unsigned int p=0; p<6; ++p)
+		{
+			const float* plane = planes[p];
+			const float x = (plane[0] > 0.0f) ? box.max.x : box.min.x;
+			const float y = (plane[1] > 0.0f) ? box.max.y : box.min.y;
+			const float z = (plane[2] > 0.0f) ? box.max.z : box.min.z;
+			if(plane[0]*x + plane[1]*y + plane[2]*z + plane[3] < 0.0f)
+				return false;
+		}
+		return true;
+	}
+};
+
+#endif // __MATRIX_HPP__
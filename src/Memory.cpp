@@ -0,0 +1,25 @@
+#include "Memory.hpp"
+
+#include <iomanip>
+#include <sstream>
+
+namespace tool_memory
+{
+	// Bytes as text in MB ("12.34 MB")
+	std::string format(const size_t bytes)
+	{
+		std::stringstream text;
+		text << std::fixed << std::setprecision(2) << bytes / (1024.0 * 1024.0) << " MB";
+		return text.str();
+	}
+
+	// Print one line of a memory report
+	void printUsage(std::ostream& out, const std::string& label, const MemoryUsage& usage)
+	{
+		out << "  " << std::left << std::setw(40) << label << std::right \
+		    << " particles : " << format(usage.particles) \
+		    << " - frame cache : " << format(usage.frameCache) \
+		    << " - scratch : " << format(usage.scratch) \
+		    << " - total : " << format(usage.total()) << std::endl;
+	}
+}
@@ -0,0 +1,69 @@
+// Memory accounting : bytes held by the figures and the subsystems,
+// counted from the capacity of their containers (what is reserved,
+// not only what is used). Allocator headers are not counted.
+
+#ifndef __MEMORY_HPP__
+#define __MEMORY_HPP__
+
+#include <cstddef>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+// Memory held by a figure or a subsystem, in bytes
+struct MemoryUsage
+{
+	size_t particles;		// boids state (group and copies moved by the figure)
+	size_t frameCache;		// data kept for each frame of an animation
+	size_t scratch;			// buffers kept between frames (culling, lookups, pools)
+
+	MemoryUsage() : particles(0), frameCache(0), scratch(0) {}
+	inline size_t total() const { return particles + frameCache + scratch; }
+	inline MemoryUsage& operator+=(const MemoryUsage& u)
+	{
+		particles += u.particles;
+		frameCache += u.frameCache;
+		scratch += u.scratch;
+		return *this;
+	}
+};
+
+namespace tool_memory
+{
+	// Node of a std::set (color, parent and children), value not included
+	const size_t SET_NODE_OVERHEAD = 4 * sizeof(void*);
+
+	// Bytes of the buffer of a vector
+	template<typename T>
+	inline size_t bytes(const std::vector<T>& v)
+	{
+		return v.capacity() * sizeof(T);
+	}
+	// Bytes of a vector of vectors (outer and inner buffers)
+	template<typename T>
+	inline size_t bytes(const std::vector< std::vector<T> >& v)
+	{
+		size_t total = v.capacity() * sizeof(std::vector<T>);
+		for(unsigned int i=0; i<v.size(); ++i)
+			total += bytes(v[i]);
+		return total;
+	}
+	// Bytes of a set of vectors (nodes and buffers of the values)
+	template<typename T>
+	inline size_t bytes(const std::set< std::vector<T> >& s)
+	{
+		size_t total = s.size() * (SET_NODE_OVERHEAD + sizeof(std::vector<T>));
+		typename std::set< std::vector<T> >::const_iterator it;
+		for(it=s.begin(); it!=s.end(); ++it)
+			total += bytes(*it);
+		return total;
+	}
+
+	// Bytes as text in MB ("12.34 MB")
+	std::string format(const size_t bytes);
+	// Print one line of a memory report
+	void printUsage(std::ostream& out, const std::string& label, const MemoryUsage& usage);
+}
+
+#endif // __MEMORY_HPP__
@@ -1,64 +1,112 @@
 #include "Mesh.hpp"
 #include "Boid.hpp"
 #include "Tools.hpp"
+#include "Random.hpp"
+#include "FrameArena.hpp"
 
 #include <cstdlib>
 #include <algorithm>
+#include <map>
 
 // Builder 
 // Create a Mesh from an obj file
-Mesh::Mesh(const std::string fileName, const float density):
+Mesh::Mesh(const std::string fileName, const float density, const uint32_t randomKey,
+	   const FrameStorage storage):
 m_model(NULL),
 m_refMesh(NULL),
 m_nbFaces(0),
-m_currentFrame(0)
+m_currentFrame(0),
+m_shownFrame(0),
+m_pointFrames(storage),
+m_roughFrames(storage)
 {
 	m_type = "3D_MESH";
 	m_density = density;
-	m_model = tool_filesystem::open3dsFile(fileName);
-	// File is OK, load the model and construct the mesh
-	_loadDataFromFile();
-	// Add to the container per frame
-	// There is only 1 entry since the model does not move
-	m_meshes.push_back(m_mesh);
-	m_roughMeshes.push_back(m_roughMesh);
-	_computeDensity();
-	_generateBoidsFromMesh();
+	m_randomKey = randomKey;
+	// There is only 1 frame since the model does not move
+	_loadFrames(std::vector<std::string>(1, fileName));
+	_updateBounds();
 }
 
 // Construct a Mesh from a 3ds file sequence
-Mesh::Mesh(const std::string filepath, const int start, const int end, const float density):
+Mesh::Mesh(const std::string filepath, const int start, const int end, const float density,
+	   const uint32_t randomKey, const FrameStorage storage):
 m_model(NULL),
 m_refMesh(NULL),
 m_nbFaces(0),
-m_currentFrame(0)
+m_currentFrame(0),
+m_shownFrame(0),
+m_pointFrames(storage),
+m_roughFrames(storage)
 {
 	m_type = "3D_MESH";
 	m_density = density;
-	std::vector<std::string> files = tool_filesystem::brute_open3dsFiles(filepath, start, end);
+	m_randomKey = randomKey;
+	_loadFrames(tool_filesystem::brute_open3dsFiles(filepath, start, end));
+	_updateBounds();
+}
+
+// Load and code the frames of the files
+// Only one file is decoded at a time : the sets of points are not kept
+void Mesh::_loadFrames(const std::vector<std::string>& files)
+{
+	m_pointFrames.reserve(files.size());
+	m_roughFrames.reserve(files.size());
+	m_roughIndicesOf.reserve(files.size());
+	m_roughHashes.reserve(files.size());
+	m_roughBounds.reserve(files.size());
+	std::vector<float> points;
 	for(unsigned int i=0; i<files.size(); ++i)
 	{
 		m_model = tool_filesystem::open3dsFile(files[i]);
 		// File is OK, load the model and construct the mesh
 		_loadDataFromFile();
-		// Add to the container per frame
-		// There is only 1 entry since the model does not move
-		m_meshes.push_back(m_mesh);
-		m_roughMeshes.push_back(m_roughMesh);
+		if(i == 0)
+			_computeDensity();
+		// Points kept by the density : the same ranks on each frame
+		points.clear();
+		std::set< std::vector<float> >::const_iterator it;
+		unsigned int rank = 0;
+		for(it=m_mesh.begin(); it!=m_mesh.end(); ++it, ++rank)
+		{
+			if(rank < m_densityKept.size() && !m_densityKept[rank])
+				continue;
+			points.insert(points.end(), it->begin(), it->end());
+		}
+		if(i == 0)
+			_generateBoidsFromMesh(points);
+		// Add to the containers per frame
+		m_pointFrames.push(points.empty() ? NULL : &points[0], points.size()/3);
+		const std::vector<float>& vertices = m_roughMesh.vertices;
+		m_roughFrames.push(vertices.empty() ? NULL : &vertices[0], vertices.size()/3);
+		// The rendered surface is the rough mesh, not the points kept by the density
+		Box roughBox;
+		for(unsigned int v=0; v+2<vertices.size(); v+=3)
+			roughBox.extend(Vec3(vertices[v], vertices[v+1], vertices[v+2]));
+		m_roughBounds.push_back(roughBox);
+		if(m_roughIndices.empty() || m_roughIndices.back() != m_roughMesh.indices)
+			m_roughIndices.push_back(m_roughMesh.indices);
+		m_roughIndicesOf.push_back(m_roughIndices.size()-1);
+		m_roughHashes.push_back(m_roughMesh.hash);
 	}
-	// Put back the reader at top 
-	m_roughMesh = m_roughMeshes.at(0);
-	m_mesh = m_meshes.at(0);
-	_computeDensity();
-	_generateBoidsFromMesh();
+	// The loading data is not needed anymore
+	m_pointFrames.endLoading();
+	m_roughFrames.endLoading();
+	m_mesh.clear();
+	std::vector<bool>().swap(m_densityKept);
+	std::vector<float>().swap(m_roughMesh.vertices);
+	std::vector<int>().swap(m_roughMesh.indices);
 }
 
 // Load Mesh data from file
 void Mesh::_loadDataFromFile()
 {
 	// Pre-clean functions
-	m_roughMesh.clear();
+	m_roughMesh.vertices.clear();
+	m_roughMesh.indices.clear();
 	m_mesh.clear();
+	// Index of each point in the welded rough mesh
+	std::map< std::vector<float>, int > weldedIndex;
 	// Loop through all the meshes
 	// (better to keep 1 per file)
 	//@WARNING : do use an int for warning when build
@@ -92,50 +140,85 @@ void Mesh::_loadDataFromFile()
 			// Use a set dramatically reduced the number of points
 			// Else the same point is stored for each face
 			m_mesh.insert(point);
-			// Add this point to rough data
-			m_roughMesh.push_back(point);
+			// Add this point to rough data, welded so that faces
+			// sharing a point stay connected once subdivided
+			std::map< std::vector<float>, int >::iterator found = weldedIndex.find(point);
+			if(found == weldedIndex.end())
+			{
+				const int index = m_roughMesh.vertices.size()/3;
+				found = weldedIndex.insert(std::make_pair(point, index)).first;
+				for(unsigned int idx=0; idx<3; ++idx)
+					m_roughMesh.vertices.push_back(point[idx]);
+			}
+			m_roughMesh.indices.push_back(found->second);
 		    }
 		}
 	} 
+	m_roughMesh.hash = tool_renderman::hashGeometry(m_roughMesh.vertices, m_roughMesh.indices);
+	// Everything is copied : the file is not needed anymore
+	lib3ds_file_free(m_model);
+	m_model = NULL;
+	m_refMesh = NULL;
 }
 
 // Generate boid field	
-void Mesh::_generateBoidsFromMesh()
+void Mesh::_generateBoidsFromMesh(const std::vector<float>& points)
 {
 	m_group.clear();
-	std::set< std::vector<float> >::iterator it;
-	for (it=m_mesh.begin(); it!=m_mesh.end(); ++it)
+	m_group.reserve(points.size()/3);
+	for(unsigned int i=0; i<points.size(); i+=3)
 	{
 		// Always add the first one
-		Boid b(0);			
+		// (unique id : the LOD keeps the same boids on each frame)
+		Boid b(m_group.size(), m_randomKey);
 		for(unsigned int j=0; j<3; ++j)
-			b.setPosition(j, it->at(j));
+			b.setPosition(j, points[i+j]);
 
  		// Add this point as a new Boid
 		m_group.push_back(b);
 	}
 }
 
-// Manage the density defined for the Mesh
+// Manage the density defined for the Mesh (points of the first frame to keep)
+// The points left are counted in a Fenwick tree : the point of a random rank
+// is found in log(n) steps, the same points are removed as erasing from the set
 void Mesh::_computeDensity()
 {
 	// Randomly remove point to respect density
-	const int nbMeshes = m_mesh.size()*(float)m_density;
-	while((int)m_mesh.size() > nbMeshes)
+	const unsigned int nbPoints = m_mesh.size();
+	const int nbMeshes = nbPoints*(float)m_density;
+	m_densityKept.assign(nbPoints, true);
+	std::vector<int> tree(nbPoints+1, 0);
+	for(unsigned int i=1; i<=nbPoints; ++i)
+	{
+		++tree[i];
+		const unsigned int parent = i + (i & -i);
+		if(parent <= nbPoints)
+			tree[parent] += tree[i];
+	}
+	unsigned int highBit = 1;
+	while(highBit*2 <= nbPoints)
+		highBit *= 2;
+	unsigned int left = nbPoints;
+	unsigned int removal = 0;
+	while((int)left > nbMeshes)
 	{
-		const float random = rand()/(float) RAND_MAX; 
-		const int randIdx = m_mesh.size()*random;
-		std::set< std::vector<float> >::iterator it0 = m_mesh.begin();
-		for(int l=0; l<randIdx; ++l)
-			++it0;
-		m_mesh.erase(it0);
-		for(unsigned int i=1; i<m_meshes.size(); ++i)
+		const float random = tool_random::uniform(m_randomKey, tool_random::STREAM_DENSITY, 0, removal++);
+		int rank = left*random;
+		// Last position with at most rank points left before it
+		unsigned int position = 0;
+		for(unsigned int bit=highBit; bit>0; bit>>=1)
 		{
-			std::set< std::vector<float> >::iterator it = m_meshes[i].begin();
-			for(int l=0; l<randIdx; ++l)
-				++it;
-			m_meshes[i].erase(it);
+			if(position+bit <= nbPoints && tree[position+bit] <= rank)
+			{
+				position += bit;
+				rank -= tree[position];
+			}
 		}
+		m_densityKept[position] = false;
+		for(unsigned int i=position+1; i<=nbPoints; i+=i & -i)
+			--tree[i];
+		--left;
 	}
 }
 
@@ -167,75 +250,62 @@ void Mesh::_adaptMesh()
 
 // Move : do nothing
 //@WARNING virtual function, needs to be overwritten
+// The frame is decoded in the frame arena (no copy of the cached frame)
 void Mesh::move()
 {
-	if((unsigned int)m_currentFrame+1 < m_meshes.size())
+	if((unsigned int)m_currentFrame+1 < m_pointFrames.size())
 	{
 		++m_currentFrame;
-		m_roughMesh = m_roughMeshes.at(m_currentFrame);
-		m_mesh = m_meshes.at(m_currentFrame);
+		m_shownFrame = m_currentFrame;
 		// We need to use the same boids else
 		// the intensity changes
-		std::set< std::vector<float> >::iterator it;
-		unsigned int i = 0;
-		for (it=m_mesh.begin(); it!=m_mesh.end(); ++it)
+		const unsigned int nbFramePoints = m_pointFrames.nbPoints(m_currentFrame);
+		float * points = FrameArena::local().alloc<float>(3*nbFramePoints);
+		m_pointFrames.decode(m_currentFrame, points);
+		const unsigned int nbPoints = std::min(nbFramePoints, (unsigned int)m_group.size());
+		for(unsigned int i=0; i<nbPoints; ++i)
 		{
-			m_group[i].setPosition(0, it->at(0));
-			m_group[i].setPosition(1, it->at(1));
-			m_group[i].setPosition(2, it->at(2));
-			++i;
+			m_group[i].setPosition(0, points[3*i]);
+			m_group[i].setPosition(1, points[3*i+1]);
+			m_group[i].setPosition(2, points[3*i+2]);
 		}
 	}
 	else
 		m_currentFrame = 0;
+	_updateBounds();
 } 
 
-// Render - functions RenderMan
-void Mesh::render()
+// Memory - bytes held by the mesh
+MemoryUsage Mesh::memoryUsage() const
 {
-	// Convert the rough mesh for Renderman
-	std::vector<float> currentMesh;
-	for(unsigned int i=0; i<m_roughMesh.size() ; ++i)
+	MemoryUsage usage = Figure::memoryUsage();
+	usage.frameCache += m_pointFrames.memoryBytes() + m_roughFrames.memoryBytes() \
+		+ tool_memory::bytes(m_roughIndices) + tool_memory::bytes(m_roughIndicesOf) \
+		+ tool_memory::bytes(m_roughHashes) + tool_memory::bytes(m_roughBounds);
+	return usage;
+}
+
+// Render - copy the data needed by the RIB files of the current frame
+void Mesh::snapshot(RenderJob& job) const
+{
+	Figure::snapshot(job);
+	job.isMesh = true;
+	job.geometryHash = m_roughHashes[m_shownFrame];
+	// Culled on the box of the exported rough mesh (the points can be thinned
+	// by the density), the displacement can push the surface out of it
+	const Frustum frustum = tool_renderman::cameraFrustum(m_cameraMatrix);
+	const Box bounds = transformBox(m_transform, m_roughBounds[m_shownFrame]);
+	job.visible = frustum.intersects(bounds.padded(tool_renderman::MESH_DISPLACEMENT_BOUND));
+	if(job.visible)
 	{
-		for(unsigned int idx=0; idx<3; ++idx)
-			currentMesh.push_back(m_roughMesh.at(i).at(idx));
+		job.vertices.resize(3*m_roughFrames.nbPoints(m_shownFrame));
+		if(!job.vertices.empty())
+			m_roughFrames.decode(m_shownFrame, &job.vertices[0]);
+		job.indices = m_roughIndices[m_roughIndicesOf[m_shownFrame]];
+	}
+	else
+	{
+		job.vertices.clear();
+		job.indices.clear();
 	}
-
-	// Matte Pass
-	std::string figureNameMatte = m_type + "_" + m_name + "_matte";
-	tool_renderman::generateRIBHeader(figureNameMatte, m_renderFrame, m_cameraMatrix);
-	RiWorldBegin();
-	tool_renderman::shadeMeshMattePass();
-	tool_renderman::renderMesh(currentMesh);
-	tool_renderman::generateRIBFileFooter();
-
-	// Skin Pass
-	std::string figureNameSkin = m_type + "_" + m_name + "_skin";
-	tool_renderman::generateRIBHeader(figureNameSkin, m_renderFrame, m_cameraMatrix);
-	RiWorldBegin();
-	float intensity = 1.0f;
-	RiLightSource("distantlight", "intensity", &intensity, RI_NULL);
-	tool_renderman::shadeMeshSkinPass();
-	tool_renderman::renderMesh(currentMesh);
-	tool_renderman::generateRIBFileFooter();
-
-	// Reflect Pass
-	std::string figureNameReflect = m_type + "_" + m_name + "_refect";
-	tool_renderman::generateRIBHeader(figureNameReflect, m_renderFrame, m_cameraMatrix);
-	RiWorldBegin();
-	tool_renderman::shadeMeshReflectPass();
-	tool_renderman::renderMesh(currentMesh);
-	tool_renderman::generateRIBFileFooter();
-
-	// Boids pass
-	std::string figureNameBoid = m_type + "_" + m_name +"_boids";
-	tool_renderman::generateRIBHeader(figureNameBoid, m_renderFrame, m_cameraMatrix);
-	// Render specific for figures
-	RiWorldBegin();
-	for(unsigned int i=0; i<m_group.size(); ++i)
-		tool_renderman::renderOneBoid(m_group[i]);
-	tool_renderman::generateRIBFileFooter();
-
-	++m_renderFrame;
 }
-
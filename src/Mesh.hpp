@@ -7,53 +7,77 @@
 #include <iostream>
 #include <vector>
 #include <set>
+#include <stdint.h>
 #include "math.h"
 
 #include "Figure.hpp"
 #include "Boid.hpp"
+#include "FrameSequence.hpp"
+
+// Welded triangle mesh used for the Renderman export
+typedef struct
+{
+	std::vector<float> vertices;	// unique points (x,y,z)
+	std::vector<int> indices;	// 3 indices per face into vertices
+	uint64_t hash;			// content hash (same geometry shares one RIB archive)
+}
+IndexedMesh;
 
 class Mesh : public Figure
 {
 private :
 	// Attributes
-	Lib3dsFile * m_model;           		// Model (analyzed 3DS file)
-	Lib3dsMesh * m_refMesh;				// Mesh reference
+	Lib3dsFile * m_model;           		// Model (3DS file being loaded, freed once read)
+	Lib3dsMesh * m_refMesh;				// Mesh reference (file being loaded)
 	int m_nbFaces;					// Number of faces of the Mesh
 	float m_density;				// Transform the point to boids	
 	//@WARNING float* due to lib3ds
     	float m_boundingMin[3], m_boundingMax[3];     	// Bounding box
 	//this info does not contain double,
-	std::set< std::vector<float> > m_mesh;		// tried data
+	std::set< std::vector<float> > m_mesh;		// tried data (file being loaded)
 	//@WARNING to keep ?
 	// It would be usefull to store them
 	// for the potential renderman shaders	
-	std::vector< std::vector<float> > m_roughMesh;  	// rough mesh
+	IndexedMesh m_roughMesh;  			// rough mesh (file being loaded)
 
 	// Animation attributes
 	unsigned int m_currentFrame;					// current frame (default 0)	
-	std::vector< std::set< std::vector<float> > > m_meshes;		// mesh per frame
-	std::vector< std::vector< std::vector<float> > > m_roughMeshes; // roughMesh per frame
+	unsigned int m_shownFrame;					// frame of the boids positions
+	FrameSequence m_pointFrames;					// boids positions per frame
+	std::vector<bool> m_densityKept;				// points kept by the density (file being loaded)
+	// roughMesh per frame : the faces are only stored when they change
+	FrameSequence m_roughFrames;					// rough vertices per frame
+	std::vector< std::vector<int> > m_roughIndices;			// faces of the frames
+	std::vector<unsigned int> m_roughIndicesOf;			// frame -> faces
+	std::vector<uint64_t> m_roughHashes;				// frame -> geometry hash
+	std::vector<Box> m_roughBounds;					// frame -> box of the rough vertices (culling)
 	
 public :
 	// Builder
 	// Construct a Mesh from a 3ds file
-	Mesh(const std::string filename, const float density=1.0f);
+	// randomKey : key of the random numbers of the figure (see tool_random)
+	// storage : how the frames are kept in memory
+	Mesh(const std::string filename, const float density=1.0f, const uint32_t randomKey=0,
+	     const FrameStorage storage=FRAMES_QUANTIZED);
 	// Construct a Mesh from a 3ds file sequence
-	Mesh(const std::string filepath, const int start, const int end, const float density=1.0f);
+	Mesh(const std::string filepath, const int start, const int end, const float density=1.0f,
+	     const uint32_t randomKey=0, const FrameStorage storage=FRAMES_QUANTIZED);
 
 	// Move the Mesh (animation)
 	void move();
-	//Draw function OpenGL
-	void brutalDraw();
-	// Render - functions RenderMan
-	void render();
+	// Render - copy the data needed by the RIB files of the current frame
+	void snapshot(RenderJob& job) const;
+	// Memory - bytes held by the mesh
+	MemoryUsage memoryUsage() const;
 	
 private:
+	// Load and code the frames of the files
+	void _loadFrames(const std::vector<std::string>& files);
 	// Load Mesh data from file
 	void _loadDataFromFile();
-	// Generate boid field	
-	void _generateBoidsFromMesh();
-	// Manage the density defined for the Mesh
+	// Generate boid field (points : x,y,z)
+	void _generateBoidsFromMesh(const std::vector<float>& points);
+	// Manage the density defined for the Mesh (points of the first frame to keep)
 	void _computeDensity();
 	// Adapt mesh to be between 0 and 1
 	void _adaptMesh();               
@@ -0,0 +1,246 @@
+#include "ParticleCache.hpp"
+
+#include <iostream>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Builder
+ParticleCacheWriter::ParticleCacheWriter(const std::string& path):
+m_path(path),
+m_file(NULL),
+m_stopped(false),
+m_offset(0),
+m_maxBoids(0)
+{
+}
+
+// A recording not closed is removed
+ParticleCacheWriter::~ParticleCacheWriter()
+{
+	if(m_file != NULL)
+	{
+		fclose(m_file);
+		remove((m_path + ".part").c_str());
+	}
+}
+
+// Add the boids of the next frame
+// The arrays are gathered from the group one after the other (one buffer)
+void ParticleCacheWriter::writeFrame(const std::vector<Boid>& group)
+{
+	if(m_stopped)
+		return;
+	if(m_file == NULL)
+	{
+		m_file = fopen((m_path + ".part").c_str(), "wb");
+		if(m_file == NULL)
+		{
+			std::cout << "WARNING unable to write the particle cache " << m_path << ".part" << std::endl;
+			m_stopped = true;
+			return;
+		}
+		// The header is written again once the index is known
+		ParticleCacheHeader header;
+		memset(&header, 0, sizeof(header));
+		_write(&header, sizeof(header));
+	}
+	const unsigned int nbBoids = group.size();
+	ParticleCacheEntry entry;
+	entry.offset = m_offset;
+	entry.nbBoids = nbBoids;
+	entry.reserved = 0;
+	m_index.push_back(entry);
+	if(nbBoids > m_maxBoids)
+		m_maxBoids = nbBoids;
+	if(nbBoids == 0)
+		return;
+
+	m_buffer.resize(3*nbBoids);
+	for(unsigned int i=0; i<nbBoids; ++i)
+	{
+		m_buffer[3*i] = group[i].position(0);
+		m_buffer[3*i+1] = group[i].position(1);
+		m_buffer[3*i+2] = group[i].position(2);
+	}
+	_write(&m_buffer[0], 3*nbBoids*sizeof(float));
+	for(unsigned int i=0; i<nbBoids; ++i)
+		m_buffer[i] = group[i].intensity();
+	_write(&m_buffer[0], nbBoids*sizeof(float));
+	for(unsigned int i=0; i<nbBoids; ++i)
+		m_buffer[i] = group[i].size();
+	_write(&m_buffer[0], nbBoids*sizeof(float));
+	// Ids : the boids of a compacted group keep theirs (LOD keys)
+	m_ids.resize(nbBoids);
+	for(unsigned int i=0; i<nbBoids; ++i)
+		m_ids[i] = (uint32_t)group[i].idBoid();
+	_write(&m_ids[0], nbBoids*sizeof(uint32_t));
+	_align();
+}
+
+// Write the index and the header, the cache can be replayed
+// Returns false on a write error (the recording is removed)
+bool ParticleCacheWriter::close()
+{
+	if(m_file == NULL)
+		return false;
+	m_stopped = true;
+	ParticleCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, PARTICLE_CACHE_MAGIC, sizeof(header.magic));
+	header.version = PARTICLE_CACHE_VERSION;
+	header.nbFrames = m_index.size();
+	header.indexOffset = m_offset;
+	header.maxBoids = m_maxBoids;
+	if(!m_index.empty())
+		_write(&m_index[0], m_index.size()*sizeof(ParticleCacheEntry));
+	if(ferror(m_file) || fseek(m_file, 0, SEEK_SET) != 0 \
+	   || fwrite(&header, sizeof(header), 1, m_file) != 1)
+	{
+		_abort("write error");
+		return false;
+	}
+	const bool closed = (fclose(m_file) == 0);
+	m_file = NULL;
+	if(!closed || rename((m_path + ".part").c_str(), m_path.c_str()) != 0)
+	{
+		std::cout << "WARNING unable to write the particle cache " << m_path << std::endl;
+		remove((m_path + ".part").c_str());
+		return false;
+	}
+	std::cout << "Particle cache " << m_path << " : " << m_index.size() << " frames, " \
+		  << tool_memory::format(m_offset + m_index.size()*sizeof(ParticleCacheEntry)) << std::endl;
+	return true;
+}
+
+// Memory - index and frame buffer
+MemoryUsage ParticleCacheWriter::memoryUsage() const
+{
+	MemoryUsage usage;
+	usage.scratch = tool_memory::bytes(m_index) + tool_memory::bytes(m_buffer) + tool_memory::bytes(m_ids);
+	return usage;
+}
+
+// Write bytes at the end of the data
+void ParticleCacheWriter::_write(const void* data, const size_t size)
+{
+	fwrite(data, 1, size, m_file);
+	m_offset += size;
+}
+
+// Write zeros up to the alignment
+void ParticleCacheWriter::_align()
+{
+	static const char zeros[ALIGNMENT] = { 0 };
+	const size_t padding = (ALIGNMENT - m_offset % ALIGNMENT) % ALIGNMENT;
+	_write(zeros, padding);
+}
+
+// Stop the recording on an error (the file is removed)
+void ParticleCacheWriter::_abort(const std::string& reason)
+{
+	std::cout << "WARNING particle cache " << m_path << " not written (" << reason << ")" << std::endl;
+	fclose(m_file);
+	m_file = NULL;
+	m_stopped = true;
+	remove((m_path + ".part").c_str());
+}
+
+// Builder
+// The file is checked : an invalid file gives an empty cache (see isValid)
+ParticleCache::ParticleCache(const std::string& path):
+m_path(path),
+m_data(NULL),
+m_size(0),
+m_header(NULL),
+m_index(NULL)
+{
+	const int file = open(path.c_str(), O_RDONLY);
+	if(file < 0)
+		return;
+	struct stat status;
+	if(fstat(file, &status) == 0 && status.st_size > 0)
+	{
+		m_size = status.st_size;
+		void* data = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if(data != MAP_FAILED)
+			m_data = (const char*)data;
+	}
+	// The mapping keeps the file
+	::close(file);
+	if(m_data == NULL)
+	{
+		std::cout << "WARNING unable to map the particle cache " << path << std::endl;
+		return;
+	}
+	std::string reason;
+	if(!_check(reason))
+	{
+		std::cout << "WARNING invalid particle cache " << path << " (" << reason << ")" << std::endl;
+		_close();
+		return;
+	}
+	// Played from the first frame to the last one
+	madvise((void*)m_data, m_size, MADV_SEQUENTIAL);
+}
+
+ParticleCache::~ParticleCache()
+{
+	_close();
+}
+
+// Check the header, the index and the chunks against the file size
+bool ParticleCache::_check(std::string& reason)
+{
+	if(m_size < sizeof(ParticleCacheHeader))
+	{
+		reason = "file too short";
+		return false;
+	}
+	const ParticleCacheHeader* header = (const ParticleCacheHeader*)m_data;
+	if(memcmp(header->magic, PARTICLE_CACHE_MAGIC, sizeof(header->magic)) != 0)
+	{
+		reason = "not a particle cache";
+		return false;
+	}
+	if(header->version != PARTICLE_CACHE_VERSION)
+	{
+		reason = "unknown version";
+		return false;
+	}
+	if(header->indexOffset > m_size \
+	   || header->nbFrames > (m_size - header->indexOffset) / sizeof(ParticleCacheEntry))
+	{
+		reason = "index out of the file";
+		return false;
+	}
+	const ParticleCacheEntry* index = (const ParticleCacheEntry*)(m_data + header->indexOffset);
+	for(unsigned int i=0; i<header->nbFrames; ++i)
+	{
+		// x,y,z, intensity, size and id of each boid, between the header and the index
+		const uint64_t bytes = (uint64_t)index[i].nbBoids * 6 * sizeof(float);
+		if(index[i].offset % sizeof(float) != 0 || index[i].offset < sizeof(ParticleCacheHeader) \
+		   || index[i].offset > header->indexOffset \
+		   || bytes > header->indexOffset - index[i].offset || index[i].nbBoids > header->maxBoids)
+		{
+			reason = "frame out of the file";
+			return false;
+		}
+	}
+	m_header = header;
+	m_index = index;
+	return true;
+}
+
+// Unmap the file
+void ParticleCache::_close()
+{
+	if(m_data != NULL)
+		munmap((void*)m_data, m_size);
+	m_data = NULL;
+	m_size = 0;
+	m_header = NULL;
+	m_index = NULL;
+}
@@ -0,0 +1,143 @@
+// Particle cache : the boids of a figure over a play sequence, simulated
+// once and replayed from a memory mapped file.
+// File layout (native byte order) :
+//   header	ParticleCacheHeader (fixed size)
+//   frames	one chunk per frame, 16 bytes aligned, struct of arrays :
+//		positions (x,y,z per boid), then intensities, then sizes,
+//		then ids (uint32, the LOD keys of the boids)
+//   index	one ParticleCacheEntry per frame, at header.indexOffset
+// The writer streams into "<path>.part" and renames it once the index
+// is written : a file cut during the recording is never replayed.
+
+#ifndef __PARTICLECACHE_HPP__
+#define __PARTICLECACHE_HPP__
+
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Boid.hpp"
+#include "Memory.hpp"
+
+// Start of the file
+typedef struct
+{
+	char magic[8];			// PARTICLE_CACHE_MAGIC
+	uint32_t version;		// PARTICLE_CACHE_VERSION
+	uint32_t nbFrames;		// entries of the index
+	uint64_t indexOffset;		// position of the index in the file
+	uint32_t maxBoids;		// most boids in one frame
+	uint32_t reserved;
+}
+ParticleCacheHeader;
+
+// Index entry of a frame
+typedef struct
+{
+	uint64_t offset;		// chunk of the frame in the file
+	uint32_t nbBoids;		// boids of the frame
+	uint32_t reserved;
+}
+ParticleCacheEntry;
+
+const char PARTICLE_CACHE_MAGIC[8] = { 'F', 'G', 'P', 'C', 'A', 'C', 'H', 'E' };
+const uint32_t PARTICLE_CACHE_VERSION = 2;
+
+// Records the boids of a figure, one frame after the other
+// The file is opened on the first frame
+class ParticleCacheWriter
+{
+private :
+	std::string m_path;				// cache file (written once closed)
+	FILE * m_file;					// "<path>.part" being written (NULL : none)
+	bool m_stopped;					// closed or failed : nothing more is written
+	uint64_t m_offset;				// end of the written data
+	uint32_t m_maxBoids;				// most boids in one frame
+	std::vector<ParticleCacheEntry> m_index;	// entries of the written frames
+	std::vector<float> m_buffer;			// one array of the frame (reused)
+	std::vector<uint32_t> m_ids;			// ids of the frame (reused)
+	static const unsigned int ALIGNMENT = 16;	// chunks start (SSE loads)
+
+public :
+	// Builder
+	ParticleCacheWriter(const std::string& path);
+	// A recording not closed is removed
+	~ParticleCacheWriter();
+
+	// Add the boids of the next frame
+	void writeFrame(const std::vector<Boid>& group);
+	// Write the index and the header, the cache can be replayed
+	// Returns false on a write error (the recording is removed)
+	bool close();
+
+	// Usual
+	inline const std::string& path() const { return m_path; }
+	inline unsigned int nbFrames() const { return m_index.size(); }
+	// Memory - index and frame buffer
+	MemoryUsage memoryUsage() const;
+
+private :
+	// Write bytes at the end of the data
+	void _write(const void* data, const size_t size);
+	// Write zeros up to the alignment
+	void _align();
+	// Stop the recording on an error (the file is removed)
+	void _abort(const std::string& reason);
+	// Not copyable (owns its file)
+	ParticleCacheWriter(const ParticleCacheWriter&);
+	ParticleCacheWriter& operator=(const ParticleCacheWriter&);
+};
+
+// Reads a cache from a memory mapped file, nothing is copied
+// The arrays of a frame stay valid while the cache is open
+class ParticleCache
+{
+private :
+	std::string m_path;				// cache file
+	const char * m_data;				// mapped file (NULL : not valid)
+	size_t m_size;					// bytes mapped
+	const ParticleCacheHeader * m_header;
+	const ParticleCacheEntry * m_index;
+
+public :
+	// Builder
+	// The file is checked : an invalid file gives an empty cache (see isValid)
+	ParticleCache(const std::string& path);
+	~ParticleCache();
+
+	// Usual
+	inline bool isValid() const { return m_data != NULL; }
+	inline const std::string& path() const { return m_path; }
+	inline unsigned int nbFrames() const { return isValid() ? m_header->nbFrames : 0; }
+	inline unsigned int maxBoids() const { return isValid() ? m_header->maxBoids : 0; }
+	inline unsigned int nbBoids(const unsigned int frame) const { return m_index[frame].nbBoids; }
+	// Arrays of a frame : x,y,z per boid, intensity, size and id per boid
+	inline const float* positions(const unsigned int frame) const
+	{
+		return (const float*)(m_data + m_index[frame].offset);
+	}
+	inline const float* intensities(const unsigned int frame) const
+	{
+		return positions(frame) + 3*m_index[frame].nbBoids;
+	}
+	inline const float* sizes(const unsigned int frame) const
+	{
+		return positions(frame) + 4*m_index[frame].nbBoids;
+	}
+	inline const uint32_t* ids(const unsigned int frame) const
+	{
+		return (const uint32_t*)(positions(frame) + 5*m_index[frame].nbBoids);
+	}
+
+private :
+	// Check the header, the index and the chunks against the file size
+	bool _check(std::string& reason);
+	// Unmap the file
+	void _close();
+	// Not copyable (owns its mapping)
+	ParticleCache(const ParticleCache&);
+	ParticleCache& operator=(const ParticleCache&);
+};
+
+#endif // __PARTICLECACHE_HPP__
@@ -0,0 +1,191 @@
+#include "PointRenderer.hpp"
+#include "Tools.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+// Vertex attributes locations
+static const GLuint ATTRIB_POSITION = 0;
+static const GLuint ATTRIB_SIZE = 1;
+static const GLuint ATTRIB_INTENSITY = 2;
+
+// Smallest sprite on screen (pixels, also in the vertex shader)
+static const float MIN_POINT_SIZE = 1.5f;
+
+// Sprite sized as the renderman sphere, Kd as the star_core surface
+static const char* POINT_VERTEX_SHADER =
+	"#version 120\n"
+	"attribute vec3 a_position;\n"
+	"attribute float a_size;\n"
+	"attribute float a_intensity;\n"
+	"uniform float u_radiusScale;\n"
+	"uniform float u_intensityScale;\n"
+	"uniform float u_pixelsPerUnit;\n"
+	"uniform vec2 u_radius;\n"
+	"varying float v_kd;\n"
+	"void main()\n"
+	"{\n"
+	"	vec4 eye = gl_ModelViewMatrix * vec4(a_position, 1.0);\n"
+	"	gl_Position = gl_ProjectionMatrix * eye;\n"
+	"	float radius = (u_radius.x + a_size * u_radius.y) * u_radiusScale;\n"
+	"	gl_PointSize = max(1.5, 2.0 * radius * u_pixelsPerUnit / max(-eye.z, 0.0001));\n"
+	"	v_kd = 0.5 + min(a_intensity * u_intensityScale, 1.0) * 0.5;\n"
+	"}\n";
+
+// Round sprite fading to its border
+static const char* POINT_FRAGMENT_SHADER =
+	"#version 120\n"
+	"varying float v_kd;\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 d = gl_PointCoord * 2.0 - 1.0;\n"
+	"	float r2 = dot(d, d);\n"
+	"	if(r2 > 1.0)\n"
+	"		discard;\n"
+	"	gl_FragColor = vec4(vec3(v_kd), 1.0 - r2);\n"
+	"}\n";
+
+// Builder (needs a current OpenGL context)
+PointRenderer::PointRenderer():
+m_useShader(false),
+m_program(0),
+m_buffer(0),
+m_radiusScaleLocation(-1),
+m_intensityScaleLocation(-1),
+m_pixelsPerUnitLocation(-1),
+m_radiusLocation(-1)
+{
+	if(!GLEW_VERSION_2_0)
+	{
+		std::cout << "WARNING OpenGL 2.0 not supported, points drawn without shader" << std::endl;
+		return;
+	}
+	m_useShader = _buildProgram();
+	if(m_useShader)
+		glGenBuffers(1, &m_buffer);
+}
+
+PointRenderer::~PointRenderer()
+{
+	if(m_buffer != 0)
+		glDeleteBuffers(1, &m_buffer);
+	if(m_program != 0)
+		glDeleteProgram(m_program);
+}
+
+// Draw the points of one figure with the current matrices
+void PointRenderer::draw(const std::vector<float>& points, const float radiusScale,
+			 const float intensityScale, const float pixelsPerUnit)
+{
+	const unsigned int nbPoints = points.size() / POINT_STRIDE;
+	if(nbPoints == 0)
+		return;
+
+	// No shader : fixed size, intensity as color
+	if(!m_useShader)
+	{
+		glPointSize(MIN_POINT_SIZE * radiusScale);
+		glBegin(GL_POINTS);
+		for(unsigned int i=0; i<nbPoints; ++i)
+		{
+			const float* point = &points[i*POINT_STRIDE];
+			const float kd = 0.5f + std::min(point[4] * intensityScale, 1.0f) * 0.5f;
+			glColor3f(kd, kd, kd);
+			glVertex3f(point[0], point[1], point[2]);
+		}
+		glEnd();
+		return;
+	}
+
+	glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
+	glEnable(GL_POINT_SPRITE);
+	glUseProgram(m_program);
+	glUniform1f(m_radiusScaleLocation, radiusScale);
+	glUniform1f(m_intensityScaleLocation, intensityScale);
+	glUniform1f(m_pixelsPerUnitLocation, pixelsPerUnit);
+	glUniform2f(m_radiusLocation, tool_renderman::boidRadius(0.0f), \
+		    tool_renderman::boidRadius(1.0f) - tool_renderman::boidRadius(0.0f));
+
+	// Orphan the previous data, the driver does not wait for the last draw
+	const GLsizei stride = POINT_STRIDE * sizeof(float);
+	glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+	glBufferData(GL_ARRAY_BUFFER, points.size() * sizeof(float), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, points.size() * sizeof(float), &points[0]);
+	glEnableVertexAttribArray(ATTRIB_POSITION);
+	glEnableVertexAttribArray(ATTRIB_SIZE);
+	glEnableVertexAttribArray(ATTRIB_INTENSITY);
+	glVertexAttribPointer(ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, stride, (const GLvoid*)0);
+	glVertexAttribPointer(ATTRIB_SIZE, 1, GL_FLOAT, GL_FALSE, stride, (const GLvoid*)(3*sizeof(float)));
+	glVertexAttribPointer(ATTRIB_INTENSITY, 1, GL_FLOAT, GL_FALSE, stride, (const GLvoid*)(4*sizeof(float)));
+
+	glDrawArrays(GL_POINTS, 0, nbPoints);
+
+	glDisableVertexAttribArray(ATTRIB_POSITION);
+	glDisableVertexAttribArray(ATTRIB_SIZE);
+	glDisableVertexAttribArray(ATTRIB_INTENSITY);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glUseProgram(0);
+	glDisable(GL_POINT_SPRITE);
+	glDisable(GL_VERTEX_PROGRAM_POINT_SIZE);
+}
+
+// Compile one shader, 0 on error
+GLuint PointRenderer::_compile(const GLenum type, const char* source)
+{
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source, NULL);
+	glCompileShader(shader);
+	GLint status = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if(status != GL_TRUE)
+	{
+		char log[1024];
+		glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+		std::cout << "WARNING point shader compilation failed : " << log << std::endl;
+		glDeleteShader(shader);
+		return 0;
+	}
+	return shader;
+}
+
+// Build the point sprite program, false on error
+bool PointRenderer::_buildProgram()
+{
+	GLuint vertexShader = _compile(GL_VERTEX_SHADER, POINT_VERTEX_SHADER);
+	GLuint fragmentShader = _compile(GL_FRAGMENT_SHADER, POINT_FRAGMENT_SHADER);
+	if(vertexShader == 0 || fragmentShader == 0)
+	{
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+		return false;
+	}
+
+	m_program = glCreateProgram();
+	glAttachShader(m_program, vertexShader);
+	glAttachShader(m_program, fragmentShader);
+	glBindAttribLocation(m_program, ATTRIB_POSITION, "a_position");
+	glBindAttribLocation(m_program, ATTRIB_SIZE, "a_size");
+	glBindAttribLocation(m_program, ATTRIB_INTENSITY, "a_intensity");
+	glLinkProgram(m_program);
+	// The program keeps the shaders
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	GLint status = GL_FALSE;
+	glGetProgramiv(m_program, GL_LINK_STATUS, &status);
+	if(status != GL_TRUE)
+	{
+		char log[1024];
+		glGetProgramInfoLog(m_program, sizeof(log), NULL, log);
+		std::cout << "WARNING point shader link failed : " << log << std::endl;
+		glDeleteProgram(m_program);
+		m_program = 0;
+		return false;
+	}
+
+	m_radiusScaleLocation = glGetUniformLocation(m_program, "u_radiusScale");
+	m_intensityScaleLocation = glGetUniformLocation(m_program, "u_intensityScale");
+	m_pixelsPerUnitLocation = glGetUniformLocation(m_program, "u_pixelsPerUnit");
+	m_radiusLocation = glGetUniformLocation(m_program, "u_radius");
+	return true;
+}
@@ -0,0 +1,46 @@
+// OpenGL preview of the boids as point sprites
+// Size and intensity are per vertex attributes : one draw call per figure,
+// sized and lit in the shader like the renderman spheres.
+
+#ifndef __POINTRENDERER_HPP__
+#define __POINTRENDERER_HPP__
+
+#include "Variables.h"
+
+#include <vector>
+
+class PointRenderer
+{
+public :
+	// Floats per point in the buffers given to draw() : x, y, z, size, intensity
+	static const unsigned int POINT_STRIDE = 5;
+
+private :
+	bool m_useShader;		// false : no GLSL support, fixed function points
+	GLuint m_program;		// point sprite program
+	GLuint m_buffer;		// vertex buffer, refilled for each figure
+	GLint m_radiusScaleLocation;	// uniforms locations
+	GLint m_intensityScaleLocation;
+	GLint m_pixelsPerUnitLocation;
+	GLint m_radiusLocation;
+
+public :
+	// Builder (needs a current OpenGL context)
+	PointRenderer();
+	~PointRenderer();
+
+	// Draw the points of one figure with the current matrices
+	// points : POINT_STRIDE floats per point
+	// radiusScale, intensityScale : LOD compensation of the figure
+	// pixelsPerUnit : viewport height / (2 * tan(fovy/2)), sizes the sprites
+	void draw(const std::vector<float>& points, const float radiusScale,
+		  const float intensityScale, const float pixelsPerUnit);
+
+private :
+	// Compile one shader, 0 on error
+	GLuint _compile(const GLenum type, const char* source);
+	// Build the point sprite program, false on error
+	bool _buildProgram();
+};
+
+#endif // __POINTRENDERER_HPP__
@@ -0,0 +1,101 @@
+#include "PointTree.hpp"
+
+#include <algorithm>
+
+// Helper : order the points (with their id) on one axis
+typedef std::pair<Vec3, unsigned int> _TreePoint;
+struct _AxisLess
+{
+	int axis;
+	_AxisLess(const int a) : axis(a) {}
+	bool operator()(const _TreePoint& a, const _TreePoint& b) const { return a.first[axis] < b.first[axis]; }
+};
+
+// Build the tree on a set of points (replaces the previous one)
+void PointTree::build(const std::vector<Vec3>& points)
+{
+	m_points = points;
+	m_ids.resize(points.size());
+	m_axes.assign(points.size(), 0);
+	for(unsigned int i=0; i<points.size(); ++i)
+		m_ids[i] = i;
+	_build(0, points.size());
+}
+
+// Index of the nearest point of the built set (the set must not be empty)
+unsigned int PointTree::nearest(const Vec3& position) const
+{
+	unsigned int best = 0;
+	float bestDistance2 = -1.0f;
+	_nearest(0, m_points.size(), position, best, bestDistance2);
+	return m_ids[best];
+}
+
+// Bytes held by the tree
+size_t PointTree::memoryBytes() const
+{
+	return tool_memory::bytes(m_points) + tool_memory::bytes(m_ids) + tool_memory::bytes(m_axes);
+}
+
+// Order a range around its middle point, split on its largest axis
+void PointTree::_build(const unsigned int begin, const unsigned int end)
+{
+	if(end - begin <= 1)
+		return;
+	Box box;
+	for(unsigned int i=begin; i<end; ++i)
+		box.extend(m_points[i]);
+	const Vec3 extent = box.max - box.min;
+	int axis = 0;
+	if(extent.y > extent[axis])
+		axis = 1;
+	if(extent.z > extent[axis])
+		axis = 2;
+
+	// Median on the axis in the middle, smaller before, larger after
+	std::vector<_TreePoint> range;
+	range.reserve(end - begin);
+	for(unsigned int i=begin; i<end; ++i)
+		range.push_back(_TreePoint(m_points[i], m_ids[i]));
+	const unsigned int middle = (end - begin) / 2;
+	std::nth_element(range.begin(), range.begin() + middle, range.end(), _AxisLess(axis));
+	for(unsigned int i=begin; i<end; ++i)
+	{
+		m_points[i] = range[i-begin].first;
+		m_ids[i] = range[i-begin].second;
+	}
+	m_axes[begin + middle] = (unsigned char)axis;
+	_build(begin, begin + middle);
+	_build(begin + middle + 1, end);
+}
+
+// Look for a point nearer than best in a range
+// The far half is skipped when the split plane is farther than best
+void PointTree::_nearest(const unsigned int begin, const unsigned int end, const Vec3& position,
+			 unsigned int& best, float& bestDistance2) const
+{
+	if(begin >= end)
+		return;
+	const unsigned int middle = begin + (end - begin) / 2;
+	const Vec3 toPoint = m_points[middle] - position;
+	const float distance2 = dot(toPoint, toPoint);
+	if(bestDistance2 < 0.0f || distance2 < bestDistance2)
+	{
+		best = middle;
+		bestDistance2 = distance2;
+	}
+	const int axis = m_axes[middle];
+	const float toPlane = position[axis] - m_points[middle][axis];
+	if(toPlane < 0.0f)
+	{
+		_nearest(begin, middle, position, best, bestDistance2);
+		if(toPlane * toPlane < bestDistance2)
+			_nearest(middle + 1, end, position, best, bestDistance2);
+	}
+	else
+	{
+		_nearest(middle + 1, end, position, best, bestDistance2);
+		if(toPlane * toPlane < bestDistance2)
+			_nearest(begin, middle, position, best, bestDistance2);
+	}
+}
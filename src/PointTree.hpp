@@ -0,0 +1,38 @@
+// Static k-d tree on a set of points : nearest point queries in O(log n)
+// Built once, read only afterwards (queries are safe from several threads).
+
+#ifndef __POINTTREE_HPP__
+#define __POINTTREE_HPP__
+
+#include "Matrix.hpp"
+#include "Memory.hpp"
+
+#include <vector>
+
+class PointTree
+{
+private :
+	// Each range [begin, end) of the arrays is a node : its middle point
+	// splits the range on one axis, the halves are the children
+	std::vector<Vec3> m_points;		// points in tree order
+	std::vector<unsigned int> m_ids;	// index of each point in the built set
+	std::vector<unsigned char> m_axes;	// split axis of the node of each middle point
+
+public :
+	// Build the tree on a set of points (replaces the previous one)
+	void build(const std::vector<Vec3>& points);
+	// Index of the nearest point of the built set (the set must not be empty)
+	unsigned int nearest(const Vec3& position) const;
+	inline unsigned int size() const { return m_points.size(); }
+	// Bytes held by the tree
+	size_t memoryBytes() const;
+
+private :
+	// Order a range around its middle point, split on its largest axis
+	void _build(const unsigned int begin, const unsigned int end);
+	// Look for a point nearer than best in a range
+	void _nearest(const unsigned int begin, const unsigned int end, const Vec3& position,
+		      unsigned int& best, float& bestDistance2) const;
+};
+
+#endif // __POINTTREE_HPP__
@@ -0,0 +1,67 @@
+#include "Random.hpp"
+
+namespace tool_random
+{
+	// Seed of the scene
+	static uint32_t s_seed = 0;
+
+	// Get/set the scene seed
+	uint32_t seed()
+	{
+		return s_seed;
+	}
+
+	void setSeed(const uint32_t seed)
+	{
+		s_seed = seed;
+	}
+
+	// 4 x 32 random bits of a counter for a key
+	// Philox4x32 with 10 rounds (Salmon et al., "Parallel random numbers : as easy as 1, 2, 3")
+	void philox(const uint32_t counter[4], const uint32_t key[2], uint32_t bits[4])
+	{
+		const uint32_t M0 = 0xD2511F53;
+		const uint32_t M1 = 0xCD9E8D57;
+		const uint32_t W0 = 0x9E3779B9;
+		const uint32_t W1 = 0xBB67AE85;
+		uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+		uint32_t k0 = key[0], k1 = key[1];
+		for(unsigned int round=0; round<10; ++round)
+		{
+			const uint64_t p0 = (uint64_t)M0 * c0;
+			const uint64_t p1 = (uint64_t)M1 * c2;
+			const uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+			const uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+			c1 = (uint32_t)p1;
+			c3 = (uint32_t)p0;
+			c0 = n0;
+			c2 = n2;
+			k0 += W0;
+			k1 += W1;
+		}
+		bits[0] = c0;
+		bits[1] = c1;
+		bits[2] = c2;
+		bits[3] = c3;
+	}
+
+	// 4 uniform numbers in [0,1) at (figure, stream, id, index)
+	void uniform4(const uint32_t figure, const Stream stream, const uint32_t id, const uint32_t index, float values[4])
+	{
+		const uint32_t counter[4] = { id, index, (uint32_t)stream, 0 };
+		const uint32_t key[2] = { s_seed, figure };
+		uint32_t bits[4];
+		philox(counter, key, bits);
+		// 24 bits : every value is exact in a float, 1 is never reached
+		for(unsigned int i=0; i<4; ++i)
+			values[i] = (bits[i] >> 8) * (1.0f / 16777216.0f);
+	}
+
+	// One uniform number in [0,1) at (figure, stream, id, index)
+	float uniform(const uint32_t figure, const Stream stream, const uint32_t id, const uint32_t index)
+	{
+		float values[4];
+		uniform4(figure, stream, id, index, values);
+		return values[0];
+	}
+}
@@ -0,0 +1,32 @@
+// Counter based random numbers (Philox4x32-10)
+// A number only depends on the scene seed and its coordinates (figure,
+// stream, id, index) : the same on every run, whatever the thread
+// computing it, and no state is shared between the threads.
+
+#ifndef __RANDOM_HPP__
+#define __RANDOM_HPP__
+
+#include <stdint.h>
+
+namespace tool_random
+{
+	// Uses of the random numbers, each one has its own sequence
+	enum Stream
+	{
+		STREAM_BOID = 1,	// boid intensity and size (id : boid)
+		STREAM_PLACEMENT = 2,	// boids initial positions (id : boid, index : attempt)
+		STREAM_DENSITY = 3	// mesh points removed by the density (index : removal)
+	};
+
+	// Get/set the scene seed (<scene seed="">, 0 by default)
+	uint32_t seed();
+	void setSeed(const uint32_t seed);
+	// 4 x 32 random bits of a counter for a key
+	void philox(const uint32_t counter[4], const uint32_t key[2], uint32_t bits[4]);
+	// 4 uniform numbers in [0,1) at (figure, stream, id, index)
+	void uniform4(const uint32_t figure, const Stream stream, const uint32_t id, const uint32_t index, float values[4]);
+	// One uniform number in [0,1) at (figure, stream, id, index)
+	float uniform(const uint32_t figure, const Stream stream, const uint32_t id, const uint32_t index);
+}
+
+#endif // __RANDOM_HPP__
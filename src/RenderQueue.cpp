@@ -0,0 +1,181 @@
+#include "RenderQueue.hpp"
+#include "Tools.hpp"
+#include "FrameArena.hpp"
+
+// Builder
+RenderQueue::RenderQueue(const unsigned int nbWriters, const unsigned int capacity):
+m_capacity(capacity),
+m_nbJobs(0),
+m_nbWriting(0),
+m_stop(false)
+{
+	if(m_capacity == 0)
+		m_capacity = 1;
+	m_mutex = SDL_CreateMutex();
+	m_jobPushed = SDL_CreateCond();
+	m_jobDone = SDL_CreateCond();
+	for(unsigned int i=0; i<nbWriters; ++i)
+		m_writers.push_back(SDL_CreateThread(_writerLoop, this));
+}
+
+RenderQueue::~RenderQueue()
+{
+	// Finish the pending jobs then stop the writers
+	wait();
+	SDL_LockMutex(m_mutex);
+	m_stop = true;
+	SDL_CondBroadcast(m_jobPushed);
+	SDL_UnlockMutex(m_mutex);
+	for(unsigned int i=0; i<m_writers.size(); ++i)
+		SDL_WaitThread(m_writers[i], NULL);
+
+	for(unsigned int i=0; i<m_pool.size(); ++i)
+		delete m_pool[i];
+	SDL_DestroyCond(m_jobPushed);
+	SDL_DestroyCond(m_jobDone);
+	SDL_DestroyMutex(m_mutex);
+}
+
+// Get a free job, blocks while capacity jobs are in flight (backpressure)
+RenderJob* RenderQueue::acquire()
+{
+	RenderJob* job = NULL;
+	SDL_LockMutex(m_mutex);
+	while(m_pool.empty() && m_nbJobs >= m_capacity)
+		SDL_CondWait(m_jobDone, m_mutex);
+	if(!m_pool.empty())
+	{
+		job = m_pool.back();
+		m_pool.pop_back();
+	}
+	else
+	{
+		job = new RenderJob();
+		++m_nbJobs;
+	}
+	SDL_UnlockMutex(m_mutex);
+	return job;
+}
+
+// Hand a filled job to the writers (one task per pass)
+void RenderQueue::push(RenderJob* job)
+{
+	unsigned int passes = tool_renderman::jobPasses(*job);
+	std::string archive;
+	if(passes & tool_renderman::PASS_GEOMETRY)
+	{
+		archive = tool_renderman::_getArchiveFile(job->name, job->geometryHash);
+		// The archive directory is made once per figure, out of the lock
+		SDL_LockMutex(m_mutex);
+		const bool newFigure = m_archiveFigures.insert(job->name).second;
+		SDL_UnlockMutex(m_mutex);
+		if(newFigure)
+			tool_filesystem::makeDirectories(tool_renderman::_getArchiveDirectory(job->name));
+	}
+	SDL_LockMutex(m_mutex);
+	// Unchanged geometry is written once, the passes read the same archive
+	if((passes & tool_renderman::PASS_GEOMETRY) && !m_archives.insert(archive).second)
+		passes &= ~tool_renderman::PASS_GEOMETRY;
+	// No writer thread : write now
+	if(m_writers.empty())
+	{
+		SDL_UnlockMutex(m_mutex);
+		tool_renderman::renderPasses(*job, passes);
+		SDL_LockMutex(m_mutex);
+		_release(job);
+		SDL_UnlockMutex(m_mutex);
+		return;
+	}
+	job->nbPassesLeft = 0;
+	for(unsigned int pass=tool_renderman::PASS_MATTE; pass<=tool_renderman::PASS_GEOMETRY; pass <<= 1)
+	{
+		if(passes & pass)
+		{
+			RenderTask task;
+			task.job = job;
+			task.pass = pass;
+			m_pending.push_back(task);
+			++job->nbPassesLeft;
+		}
+	}
+	if(job->nbPassesLeft == 0)
+		_release(job);
+	else
+		SDL_CondBroadcast(m_jobPushed);
+	SDL_UnlockMutex(m_mutex);
+}
+
+// Block until every pushed job is written
+void RenderQueue::wait()
+{
+	SDL_LockMutex(m_mutex);
+	while(!m_pending.empty() || m_nbWriting > 0)
+		SDL_CondWait(m_jobDone, m_mutex);
+	SDL_UnlockMutex(m_mutex);
+}
+
+// Forget the written geometry archives (they are written again)
+void RenderQueue::clearArchives()
+{
+	SDL_LockMutex(m_mutex);
+	m_archives.clear();
+	SDL_UnlockMutex(m_mutex);
+}
+
+// Memory - bytes held by the free jobs (their buffers are kept between frames)
+// The jobs being written are not counted
+MemoryUsage RenderQueue::memoryUsage()
+{
+	MemoryUsage usage;
+	SDL_LockMutex(m_mutex);
+	for(unsigned int i=0; i<m_pool.size(); ++i)
+	{
+		const RenderJob& job = *m_pool[i];
+		usage.scratch += sizeof(RenderJob) + tool_memory::bytes(job.positions) + tool_memory::bytes(job.sizes) \
+			+ tool_memory::bytes(job.intensities) + tool_memory::bytes(job.vertices) + tool_memory::bytes(job.indices);
+	}
+	SDL_UnlockMutex(m_mutex);
+	return usage;
+}
+
+// Writer thread entry point
+int RenderQueue::_writerLoop(void* queue)
+{
+	RenderQueue* self = (RenderQueue*) queue;
+	while(true)
+	{
+		SDL_LockMutex(self->m_mutex);
+		while(self->m_pending.empty() && !self->m_stop)
+			SDL_CondWait(self->m_jobPushed, self->m_mutex);
+		if(self->m_pending.empty())
+		{
+			// Stop asked and nothing left to write
+			SDL_UnlockMutex(self->m_mutex);
+			return 0;
+		}
+		RenderTask task = self->m_pending.front();
+		self->m_pending.pop_front();
+		++self->m_nbWriting;
+		SDL_UnlockMutex(self->m_mutex);
+
+		tool_renderman::renderPass(*task.job, (tool_renderman::RenderPass)task.pass);
+		// The pass is the frame of a writer : its scratch arrays are given back
+		FrameArena::local().reset();
+
+		// Back to the pool once its last pass is written, in the same
+		// lock as the writing count so wait() never returns before
+		SDL_LockMutex(self->m_mutex);
+		--self->m_nbWriting;
+		if(--task.job->nbPassesLeft == 0)
+			self->_release(task.job);
+		SDL_UnlockMutex(self->m_mutex);
+	}
+	return 0;
+}
+
+// Give back a written job to the pool (mutex locked)
+void RenderQueue::_release(RenderJob* job)
+{
+	m_pool.push_back(job);
+	SDL_CondBroadcast(m_jobDone);
+}
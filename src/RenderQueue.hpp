@@ -0,0 +1,85 @@
+// Asynchronous RIB writing : the simulation snapshots the figures
+// into pooled jobs, writer threads serialize them to disk.
+
+#ifndef __RENDERQUEUE_HPP__
+#define __RENDERQUEUE_HPP__
+
+#include <SDL.h>
+#include <deque>
+#include <set>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Matrix.hpp"
+#include "Memory.hpp"
+
+// Snapshot of a Figure at one render frame
+// Holds everything needed to write its RIB files from another thread
+struct RenderJob
+{
+	std::string name;			// figure name (type + name)
+	unsigned int frame;			// render frame
+	Mat4 camera;				// renderman camera transform
+	Mat4 transform;				// figure placement (object to world)
+	bool visible;				// false : out of the render camera, nothing to export
+	std::vector<float> positions;		// boids positions (x,y,z)
+	std::vector<float> sizes;		// boids sizes
+	std::vector<float> intensities;		// boids intensities
+	float radiusScale;			// boids radius factor (LOD compensation)
+	bool isMesh;				// write the mesh passes
+	std::vector<float> vertices;		// welded mesh points (x,y,z)
+	std::vector<int> indices;		// mesh triangle indices
+	uint64_t geometryHash;			// content hash of the mesh
+	unsigned int nbPassesLeft;		// passes not written yet (queue use)
+};
+
+// One pass of a job, the passes of a job are written concurrently
+typedef struct
+{
+	RenderJob * job;			// snapshot to write
+	unsigned int pass;			// pass to write (tool_renderman::RenderPass)
+}
+RenderTask;
+
+class RenderQueue
+{
+private :
+	std::vector<SDL_Thread*> m_writers;	// writer threads (none : synchronous)
+	SDL_mutex * m_mutex;			// protects all of the members below
+	SDL_cond * m_jobPushed;			// signaled when a job is pending
+	SDL_cond * m_jobDone;			// signaled when a job is back in the pool
+	std::deque<RenderTask> m_pending;	// passes waiting for a writer
+	std::vector<RenderJob*> m_pool;		// free jobs (buffers are kept between frames)
+	std::set<std::string> m_archives;	// geometry archives already written
+	std::set<std::string> m_archiveFigures;	// figures whose archive directory is made
+	unsigned int m_capacity;		// max number of jobs in flight
+	unsigned int m_nbJobs;			// number of jobs allocated
+	unsigned int m_nbWriting;		// passes being written
+	bool m_stop;				// set to true to end the writer threads
+
+public :
+	// Builder
+	// nbWriters : 0 writes the jobs synchronously in push()
+	RenderQueue(const unsigned int nbWriters=1, const unsigned int capacity=8);
+	~RenderQueue();
+
+	// Get a free job, blocks while capacity jobs are in flight (backpressure)
+	RenderJob* acquire();
+	// Hand a filled job to the writers (one task per pass)
+	void push(RenderJob* job);
+	// Block until every pushed job is written
+	void wait();
+	// Forget the written geometry archives (they are written again)
+	void clearArchives();
+	// Memory - bytes held by the free jobs (their buffers are kept between frames)
+	MemoryUsage memoryUsage();
+
+private :
+	// Writer thread entry point
+	static int _writerLoop(void* queue);
+	// Give back a written job to the pool (mutex locked)
+	void _release(RenderJob* job);
+};
+
+#endif // __RENDERQUEUE_HPP__
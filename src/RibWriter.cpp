@@ -0,0 +1,512 @@
+#include "RibWriter.hpp"
+
+#include <iostream>
+#include <cstring>
+
+// Size of the output buffer before flushing to disk
+static const unsigned int RIB_BUFFER_SIZE = 1 << 16;
+
+// Binary RIB encoding (RenderMan Interface Specification, appendix C)
+static const unsigned char RIB_BIN_INT = 0200;		// + (nbBytes-1)
+static const unsigned char RIB_BIN_STRING_SHORT = 0220;	// + length (< 16)
+static const unsigned char RIB_BIN_STRING = 0240;	// + (nbBytes of length-1)
+static const unsigned char RIB_BIN_FLOAT = 0244;
+static const unsigned char RIB_BIN_REQUEST = 0246;
+static const unsigned char RIB_BIN_FLOAT_ARRAY = 0310;	// + (nbBytes of length-1)
+static const unsigned char RIB_BIN_DEFINE_REQUEST = 0314;
+static const unsigned char RIB_BIN_DEFINE_STRING = 0315;// + (nbBytes of token-1)
+static const unsigned char RIB_BIN_USE_STRING = 0317;	// + (nbBytes of token-1)
+
+// Number of bytes needed to store an unsigned value
+static unsigned int _nbBytesFor(const unsigned int value)
+{
+	if(value < (1u << 8))
+		return 1;
+	else if(value < (1u << 16))
+		return 2;
+	else if(value < (1u << 24))
+		return 3;
+	return 4;
+}
+
+// RibParams
+
+// Add a float parameter
+RibParams& RibParams::add(const std::string& token, const float value)
+{
+	return add(token, &value, 1);
+}
+
+// Add a float array parameter (values are copied)
+RibParams& RibParams::add(const std::string& token, const float* values, const unsigned int n)
+{
+	Param p;
+	p.token = token;
+	p.isString = false;
+	p.owned.assign(values, values+n);
+	p.values = NULL;
+	p.nbValues = n;
+	m_params.push_back(p);
+	return *this;
+}
+
+// Add a string parameter
+RibParams& RibParams::add(const std::string& token, const std::string& value)
+{
+	Param p;
+	p.token = token;
+	p.isString = true;
+	p.text = value;
+	p.values = NULL;
+	p.nbValues = 0;
+	m_params.push_back(p);
+	return *this;
+}
+
+// Add a float array parameter without copy
+RibParams& RibParams::addArray(const std::string& token, const float* values, const unsigned int n)
+{
+	Param p;
+	p.token = token;
+	p.isString = false;
+	p.values = values;
+	p.nbValues = n;
+	m_params.push_back(p);
+	return *this;
+}
+
+// Get the float values of a parameter
+const float* RibParams::values(const unsigned int i) const
+{
+	if(m_params[i].values != NULL)
+		return m_params[i].values;
+	if(m_params[i].owned.empty())
+		return NULL;
+	return &m_params[i].owned[0];
+}
+
+// RibWriter
+
+// Builder
+RibWriter::RibWriter():
+m_file(NULL),
+m_gzFile(NULL),
+m_encoding(ASCII),
+m_bytesWritten(0),
+m_nbLights(0)
+{
+	m_buffer.reserve(RIB_BUFFER_SIZE);
+}
+
+RibWriter::~RibWriter()
+{
+	end();
+}
+
+// Open a RIB file (RiBegin)
+bool RibWriter::begin(const std::string& file, const Encoding encoding, const bool compressed)
+{
+	end();
+	m_encoding = encoding;
+	m_bytesWritten = 0;
+	m_nbLights = 0;
+	m_requestCodes.clear();
+	m_stringTokens.clear();
+
+	if(compressed)
+		m_gzFile = gzopen(file.c_str(), "wb");
+	else
+		m_file = fopen(file.c_str(), "wb");
+	if(!isOpen())
+	{
+		std::cout << "Error : unable to open RIB file " << file << std::endl;
+		return false;
+	}
+	// Requests start on a new line in ASCII, binary needs the comment ended
+	_writeAscii("##RenderMan RIB");
+	if(m_encoding == BINARY)
+		_writeAscii("\n");
+	return true;
+}
+
+// Flush and close the RIB file (RiEnd)
+void RibWriter::end()
+{
+	if(!isOpen())
+		return;
+	if(m_encoding == ASCII)
+		_writeAscii("\n");
+	_flush();
+	if(m_file != NULL)
+		fclose(m_file);
+	if(m_gzFile != NULL)
+		gzclose(m_gzFile);
+	m_file = NULL;
+	m_gzFile = NULL;
+}
+
+// Options
+void RibWriter::display(const std::string& name, const std::string& type, const std::string& mode)
+{
+	_request("Display");
+	_string(name);
+	_string(type);
+	_string(mode);
+}
+
+void RibWriter::format(const int xResolution, const int yResolution, const float pixelAspect)
+{
+	_request("Format");
+	_int(xResolution);
+	_int(yResolution);
+	_float(pixelAspect);
+}
+
+void RibWriter::projection(const std::string& name, const RibParams& params)
+{
+	_request("Projection");
+	_string(name);
+	_params(params);
+}
+
+void RibWriter::pixelSamples(const float xSamples, const float ySamples)
+{
+	_request("PixelSamples");
+	_float(xSamples);
+	_float(ySamples);
+}
+
+// Transforms
+void RibWriter::transform(const RibMatrix matrix)
+{
+	_request("Transform");
+	_floatArray(&matrix[0][0], 16);
+}
+
+void RibWriter::concatTransform(const RibMatrix matrix)
+{
+	_request("ConcatTransform");
+	_floatArray(&matrix[0][0], 16);
+}
+
+void RibWriter::translate(const float x, const float y, const float z)
+{
+	_request("Translate");
+	_float(x);
+	_float(y);
+	_float(z);
+}
+
+// Blocks
+void RibWriter::worldBegin()
+{
+	_request("WorldBegin");
+}
+
+void RibWriter::worldEnd()
+{
+	_request("WorldEnd");
+}
+
+void RibWriter::attributeBegin()
+{
+	_request("AttributeBegin");
+}
+
+void RibWriter::attributeEnd()
+{
+	_request("AttributeEnd");
+}
+
+// Shading
+void RibWriter::attribute(const std::string& name, const RibParams& params)
+{
+	_request("Attribute");
+	_string(name);
+	_params(params);
+}
+
+void RibWriter::surface(const std::string& name, const RibParams& params)
+{
+	_request("Surface");
+	_string(name);
+	_params(params);
+}
+
+void RibWriter::displacement(const std::string& name, const RibParams& params)
+{
+	_request("Displacement");
+	_string(name);
+	_params(params);
+}
+
+// Returns the light sequence number
+int RibWriter::lightSource(const std::string& name, const RibParams& params)
+{
+	const int handle = ++m_nbLights;
+	_request("LightSource");
+	_string(name);
+	_int(handle);
+	_params(params);
+	return handle;
+}
+
+// Geometry
+void RibWriter::sphere(const float radius, const float zMin, const float zMax, const float thetaMax,
+		       const RibParams& params)
+{
+	_request("Sphere");
+	_float(radius);
+	_float(zMin);
+	_float(zMax);
+	_float(thetaMax);
+	_params(params);
+}
+
+void RibWriter::subdivisionMesh(const std::string& scheme, const int nbFaces,
+				const int* nbVertices, const int* vertices,
+				const int nbTags, const std::string* tags, const int* nbArgs,
+				const int* intArgs, const float* floatArgs,
+				const RibParams& params)
+{
+	// Count the indices and tag arguments
+	unsigned int nbIndices = 0;
+	for(int i=0; i<nbFaces; ++i)
+		nbIndices += nbVertices[i];
+	unsigned int nbIntArgs = 0;
+	unsigned int nbFloatArgs = 0;
+	for(int i=0; i<nbTags; ++i)
+	{
+		nbIntArgs += nbArgs[2*i];
+		nbFloatArgs += nbArgs[2*i+1];
+	}
+
+	_request("SubdivisionMesh");
+	_string(scheme);
+	_intArray(nbVertices, nbFaces);
+	_intArray(vertices, nbIndices);
+	_stringArray(tags, nbTags);
+	_intArray(nbArgs, 2*nbTags);
+	_intArray(intArgs, nbIntArgs);
+	_floatArray(floatArgs, nbFloatArgs);
+	_params(params);
+}
+
+// Points primitive : all of the values are given through params ("P", "width"...)
+void RibWriter::points(const RibParams& params)
+{
+	_request("Points");
+	_params(params);
+}
+
+// Include another RIB file
+void RibWriter::readArchive(const std::string& file)
+{
+	_request("ReadArchive");
+	_string(file);
+}
+
+// Start a new request
+void RibWriter::_request(const char* name)
+{
+	if(m_encoding == ASCII)
+	{
+		_writeAscii("\n");
+		_writeAscii(name);
+		return;
+	}
+	// Binary : define the request code the first time it is used
+	std::map<std::string, int>::iterator it = m_requestCodes.find(name);
+	int code = 0;
+	if(it == m_requestCodes.end())
+	{
+		code = m_requestCodes.size();
+		m_requestCodes[name] = code;
+		const unsigned int length = strlen(name);
+		char define[2] = { (char)RIB_BIN_DEFINE_REQUEST, (char)code };
+		_write(define, 2);
+		char header = (char)(RIB_BIN_STRING_SHORT + length);
+		_write(&header, 1);
+		_write(name, length);
+	}
+	else
+		code = it->second;
+	char request[2] = { (char)RIB_BIN_REQUEST, (char)code };
+	_write(request, 2);
+}
+
+// Values
+void RibWriter::_int(const int value)
+{
+	if(m_encoding == ASCII)
+	{
+		char text[16];
+		snprintf(text, sizeof(text), " %d", value);
+		_writeAscii(text);
+		return;
+	}
+	// Smallest signed width holding the value
+	unsigned int nbBytes = 4;
+	if(value >= -128 && value < 128)
+		nbBytes = 1;
+	else if(value >= -32768 && value < 32768)
+		nbBytes = 2;
+	else if(value >= -8388608 && value < 8388608)
+		nbBytes = 3;
+	char header = (char)(RIB_BIN_INT + nbBytes - 1);
+	_write(&header, 1);
+	_binaryUnsigned((unsigned int)value, nbBytes);
+}
+
+void RibWriter::_float(const float value)
+{
+	if(m_encoding == ASCII)
+	{
+		char text[32];
+		// 9 significant digits : the float read back is the one written (as binary)
+		snprintf(text, sizeof(text), " %.9g", value);
+		_writeAscii(text);
+		return;
+	}
+	char header = (char)RIB_BIN_FLOAT;
+	_write(&header, 1);
+	_binaryFloat(value);
+}
+
+void RibWriter::_string(const std::string& value)
+{
+	if(m_encoding == ASCII)
+	{
+		_writeAscii(" \"");
+		for(unsigned int i=0; i<value.size(); ++i)
+		{
+			if(value[i] == '"' || value[i] == '\\')
+				_writeAscii("\\");
+			_write(&value[i], 1);
+		}
+		_writeAscii("\"");
+		return;
+	}
+	// Binary : strings are stored once as tokens then interpolated
+	std::map<std::string, int>::iterator it = m_stringTokens.find(value);
+	if(it != m_stringTokens.end())
+	{
+		const unsigned int nbBytes = _nbBytesFor(it->second);
+		char header = (char)(RIB_BIN_USE_STRING + nbBytes - 1);
+		_write(&header, 1);
+		_binaryUnsigned(it->second, nbBytes);
+		return;
+	}
+	const unsigned int token = m_stringTokens.size();
+	if(token < (1u << 16))
+	{
+		m_stringTokens[value] = token;
+		const unsigned int nbBytes = _nbBytesFor(token);
+		char header = (char)(RIB_BIN_DEFINE_STRING + nbBytes - 1);
+		_write(&header, 1);
+		_binaryUnsigned(token, nbBytes);
+	}
+	// Raw string (definition content or too many tokens)
+	if(value.size() < 16)
+	{
+		char header = (char)(RIB_BIN_STRING_SHORT + value.size());
+		_write(&header, 1);
+	}
+	else
+	{
+		const unsigned int nbBytes = _nbBytesFor(value.size());
+		char header = (char)(RIB_BIN_STRING + nbBytes - 1);
+		_write(&header, 1);
+		_binaryUnsigned(value.size(), nbBytes);
+	}
+	_write(value.data(), value.size());
+}
+
+void RibWriter::_intArray(const int* values, const unsigned int n)
+{
+	_writeAscii(m_encoding == ASCII ? " [" : "[");
+	for(unsigned int i=0; i<n; ++i)
+		_int(values[i]);
+	_writeAscii(m_encoding == ASCII ? " ]" : "]");
+}
+
+void RibWriter::_floatArray(const float* values, const unsigned int n)
+{
+	if(m_encoding == ASCII)
+	{
+		_writeAscii(" [");
+		for(unsigned int i=0; i<n; ++i)
+			_float(values[i]);
+		_writeAscii(" ]");
+		return;
+	}
+	const unsigned int nbBytes = _nbBytesFor(n);
+	char header = (char)(RIB_BIN_FLOAT_ARRAY + nbBytes - 1);
+	_write(&header, 1);
+	_binaryUnsigned(n, nbBytes);
+	for(unsigned int i=0; i<n; ++i)
+		_binaryFloat(values[i]);
+}
+
+void RibWriter::_stringArray(const std::string* values, const unsigned int n)
+{
+	_writeAscii(m_encoding == ASCII ? " [" : "[");
+	for(unsigned int i=0; i<n; ++i)
+		_string(values[i]);
+	_writeAscii(m_encoding == ASCII ? " ]" : "]");
+}
+
+void RibWriter::_params(const RibParams& params)
+{
+	for(unsigned int i=0; i<params.size(); ++i)
+	{
+		_string(params.token(i));
+		if(params.isString(i))
+			_stringArray(&params.text(i), 1);
+		else
+			_floatArray(params.values(i), params.nbValues(i));
+	}
+}
+
+// Binary helpers
+// Write the lowest bytes of value, big endian
+void RibWriter::_binaryUnsigned(const unsigned int value, const unsigned int nbBytes)
+{
+	char bytes[4];
+	for(unsigned int i=0; i<nbBytes; ++i)
+		bytes[i] = (char)((value >> (8*(nbBytes-1-i))) & 0xff);
+	_write(bytes, nbBytes);
+}
+
+// Write an IEEE float, big endian
+void RibWriter::_binaryFloat(const float value)
+{
+	unsigned int bits;
+	memcpy(&bits, &value, sizeof(bits));
+	_binaryUnsigned(bits, 4);
+}
+
+// Raw output
+void RibWriter::_write(const char* data, const unsigned int n)
+{
+	m_buffer.insert(m_buffer.end(), data, data+n);
+	m_bytesWritten += n;
+	if(m_buffer.size() >= RIB_BUFFER_SIZE)
+		_flush();
+}
+
+void RibWriter::_writeAscii(const char* text)
+{
+	_write(text, strlen(text));
+}
+
+void RibWriter::_flush()
+{
+	if(m_buffer.empty())
+		return;
+	if(m_file != NULL)
+		fwrite(&m_buffer[0], 1, m_buffer.size(), m_file);
+	else if(m_gzFile != NULL)
+		gzwrite(m_gzFile, &m_buffer[0], m_buffer.size());
+	m_buffer.clear();
+}
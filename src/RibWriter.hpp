@@ -0,0 +1,145 @@
+// Built-in RIB serializer : writes the subset of the RenderMan
+// Interface used by FumiGen without linking any renderer library.
+// Supports ASCII and binary RIB encodings, optionally gzip compressed.
+
+#ifndef __RIBWRITER_HPP__
+#define __RIBWRITER_HPP__
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <map>
+#include <zlib.h>
+
+// RenderMan matrix (row-major 4x4, same layout as RtMatrix)
+typedef float RibMatrix[4][4];
+
+// List of token/value pairs given to a RIB request
+// Token can contain an inline declaration (ex: "uniform float Kd")
+class RibParams
+{
+private :
+	typedef struct
+	{
+		std::string token;		// Parameter token
+		bool isString;			// true for a string parameter
+		std::string text;		// string value
+		std::vector<float> owned;	// float values copied at add time
+		const float* values;		// float values not owned (large arrays)
+		unsigned int nbValues;		// number of float values
+	}
+	Param;
+	std::vector<Param> m_params;
+
+public :
+	// Add a float parameter
+	RibParams& add(const std::string& token, const float value);
+	// Add a float array parameter (values are copied)
+	RibParams& add(const std::string& token, const float* values, const unsigned int n);
+	// Add a string parameter
+	RibParams& add(const std::string& token, const std::string& value);
+	// Add a float array parameter without copy
+	//@WARNING: values must live until the request is written
+	RibParams& addArray(const std::string& token, const float* values, const unsigned int n);
+
+	// Usual
+	inline unsigned int size() const { return m_params.size(); }
+	inline const std::string& token(const unsigned int i) const { return m_params[i].token; }
+	inline bool isString(const unsigned int i) const { return m_params[i].isString; }
+	inline const std::string& text(const unsigned int i) const { return m_params[i].text; }
+	inline unsigned int nbValues(const unsigned int i) const { return m_params[i].nbValues; }
+	const float* values(const unsigned int i) const;
+};
+
+class RibWriter
+{
+public :
+	// Encoding of the RIB stream
+	enum Encoding
+	{
+		ASCII,
+		BINARY
+	};
+
+private :
+	FILE * m_file;					// Output file (plain RIB)
+	gzFile m_gzFile;				// Output file (gzip RIB)
+	Encoding m_encoding;				// ASCII or BINARY
+	std::vector<char> m_buffer;			// Output buffer, flushed by chunks
+	unsigned long m_bytesWritten;			// Total bytes given to the stream
+	unsigned int m_nbLights;			// Light handles already used
+	std::map<std::string, int> m_requestCodes;	// Binary : encoded RI requests
+	std::map<std::string, int> m_stringTokens;	// Binary : encoded string tokens
+
+public :
+	// Builder
+	RibWriter();
+	~RibWriter();
+
+	// Open a RIB file (RiBegin)
+	bool begin(const std::string& file, const Encoding encoding=ASCII, const bool compressed=false);
+	// Flush and close the RIB file (RiEnd)
+	void end();
+	// Usual
+	inline bool isOpen() const { return m_file != NULL || m_gzFile != NULL; }
+	inline unsigned long bytesWritten() const { return m_bytesWritten; }
+
+	// Options
+	void display(const std::string& name, const std::string& type, const std::string& mode);
+	void format(const int xResolution, const int yResolution, const float pixelAspect);
+	void projection(const std::string& name, const RibParams& params=RibParams());
+	void pixelSamples(const float xSamples, const float ySamples);
+
+	// Transforms
+	void transform(const RibMatrix matrix);
+	void concatTransform(const RibMatrix matrix);
+	void translate(const float x, const float y, const float z);
+
+	// Blocks
+	void worldBegin();
+	void worldEnd();
+	void attributeBegin();
+	void attributeEnd();
+
+	// Shading
+	void attribute(const std::string& name, const RibParams& params);
+	void surface(const std::string& name, const RibParams& params=RibParams());
+	void displacement(const std::string& name, const RibParams& params=RibParams());
+	// Returns the light sequence number
+	int lightSource(const std::string& name, const RibParams& params=RibParams());
+
+	// Geometry
+	void sphere(const float radius, const float zMin, const float zMax, const float thetaMax,
+		    const RibParams& params=RibParams());
+	// Tags are given as in RiSubdivisionMesh : nbArgs holds 2 counts per tag (ints, floats)
+	void subdivisionMesh(const std::string& scheme, const int nbFaces,
+			     const int* nbVertices, const int* vertices,
+			     const int nbTags, const std::string* tags, const int* nbArgs,
+			     const int* intArgs, const float* floatArgs,
+			     const RibParams& params);
+	// Points primitive : all of the values are given through params ("P", "width"...)
+	void points(const RibParams& params);
+	// Include another RIB file
+	void readArchive(const std::string& file);
+
+private :
+	// Start a new request
+	void _request(const char* name);
+	// Values
+	void _int(const int value);
+	void _float(const float value);
+	void _string(const std::string& value);
+	void _intArray(const int* values, const unsigned int n);
+	void _floatArray(const float* values, const unsigned int n);
+	void _stringArray(const std::string* values, const unsigned int n);
+	void _params(const RibParams& params);
+	// Binary helpers
+	void _binaryUnsigned(const unsigned int value, const unsigned int nbBytes);
+	void _binaryFloat(const float value);
+	// Raw output
+	void _write(const char* data, const unsigned int n);
+	void _writeAscii(const char* text);
+	void _flush();
+};
+
+#endif // __RIBWRITER_HPP__
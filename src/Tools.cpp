@@ -2,6 +2,7 @@
 
 #include "Application.hpp"
 #include "Camera.hpp"
+#include "FrameArena.hpp"
 
 #include <iostream>
 #include <iomanip>
@@ -10,157 +11,107 @@
 #include <sstream>
 #include <math.h>
 #include <set>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
 
 namespace tool_geometry 
 {
 	// To normalize a vector
-	void normalize (std::vector<float>& v)
+	void normalize (Vec3& v)
 	{
 		// Compute norm of the vector
-		float norm = 0.0f;
-		for(unsigned int idx=0; idx<3; ++idx)
-			norm += pow(v[idx],2);
-		norm = sqrt(norm);
-	
+		const float norm = sqrtf(dot(v, v));
 		// Normalize the vector
 		if (norm != 0.0f)
-		{
-			for(unsigned int idx=0; idx<3; ++idx)
-				v[idx] /= norm;
-		}
+			v = v * (1.0f/norm);
 	}
 
 	// To get the vector product
-	const std::vector<float> vectorProduct (const std::vector<float>& a,
-						const std::vector<float>& b)
+	const Vec3 vectorProduct (const Vec3& a, const Vec3& b)
 	{
-		std::vector<float> result;
-		result.push_back(a[1]*b[2] - a[2]*b[1]);
-		result.push_back(a[2]*b[0] - a[0]*b[2]);
-		result.push_back(a[0]*b[1] - a[1]*b[0]);
-		return result;
+		return cross(a, b);
 	}
 
 	// Does the multiplication A=A*B : all the matrices are described column-major
-	void multMatrixBtoMatrixA(std::vector<float>& A, const std::vector<float>& B)
-	{
-		int i = 0; 				// row index
-		int j = 0; 				// column index
-		std::vector<float> temp;		// temp values
-		for(unsigned int i=0; i<16; ++i)
-			temp.push_back(0.0f);
-	    
-		for(unsigned int idx=0 ; idx<16 ; ++idx)
-		{
-			temp[idx] = 0.0f;
-			i = idx%4;
-			j = idx/4;
-
-			for(unsigned int k=0 ; k<4 ; ++k)
-			{
-				const int idxA = k*4 + i;
-				const int idxB = j*4 + k;
-				temp[idx]+=A[idxA] * B[idxB];
-			}
-		}
-		// Recopy temp into A
-		for(unsigned int i=0 ; i<16 ; ++i)
-			A[i] = temp[i];
+	void multMatrixBtoMatrixA(Mat4& A, const Mat4& B)
+	{
+		A = A * B;
 	}
 
 	// Sets the provided matrix to identity
-	void setToIdentity(std::vector<float>& matrix)
+	void setToIdentity(Mat4& matrix)
 	{
-		float Id[] = {	1.0, 0.0, 0.0, 0.0,
-				0.0, 1.0, 0.0, 0.0, 
-				0.0, 0.0, 1.0, 0.0, 
-			 	0.0, 0.0, 0.0, 1.0
-			     };
-	
-		for(unsigned int i=0 ; i<16 ; ++i)
-			matrix[i] = Id[i];
+		matrix = Mat4();
 	}
 
 	// Sets the provided matrix to a translate matrix on vector t
-	void setToTranslate(std::vector<float>& matrix, const std::vector<float>& t)
+	void setToTranslate(Mat4& matrix, const Vec3& t)
 	{
-		float T[] = {	1.0,   0.0,   0.0,   0.0,
-			 	0.0,   1.0,   0.0,   0.0,
-			 	0.0,   0.0,   1.0,   0.0,
-			 	t[0],  t[1],  t[2],  1.0
-			    };
-	 
-	    	for(unsigned int i=0 ; i<16 ; ++i)
-			matrix[i] = T[i];
+		matrix = Mat4();
+		matrix[12] = t.x;
+		matrix[13] = t.y;
+		matrix[14] = t.z;
 	}
 
 	// Sets the provided matrix to a scale matrix by coeficients in s
-	void setToScale(std::vector<float>& matrix, const std::vector<float>& s)
+	void setToScale(Mat4& matrix, const Vec3& s)
 	{
-	    	float S[] = {	s[0], 0.0,  0.0,  0.0,
-		         	0.0,  s[1], 0.0,  0.0,
-		         	0.0,  0.0,  s[2], 0.0,
-		         	0.0,  0.0,  0.0,  1.0
-			    };  
-	    
-		for(unsigned int i=0 ; i<16 ; ++i)
-			matrix[i] = S[i];
+		matrix = Mat4();
+		matrix[0] = s.x;
+		matrix[5] = s.y;
+		matrix[10] = s.z;
 	}
 
 	// Sets the provided matrix to a rotate matrix of angle "angle", around axis "axis"
-	void setToRotate(std::vector<float>& matrix, const float angle,
-						     const std::vector<float>& axis)
+	void setToRotate(Mat4& matrix, const float angle, const Vec3& axis)
 	{
 		const float c = cos(angle);
 		const float s = sin(angle);
-		const float x = axis[0]; 
-		const float y = axis[1]; 
-		const float z = axis[2];
-		float* R;
+		const float x = axis.x; 
+		const float y = axis.y; 
+		const float z = axis.z;
 
 		// Rotation on X axis
 		if((x==1.0f) && (y==0.0f) && (z==0.0f))
 		{
-			float RX[] = {	1.0, 0.0, 0.0, 0.0, 
-				     	0.0, c,   s,   0.0, 
-				     	0.0, -s,  c,   0.0, 
-				     	0.0, 0.0, 0.0, 1.0
-				     };
-			R = RX;
+			const float RX[] = {	1.0, 0.0, 0.0, 0.0, 
+					     	0.0, c,   s,   0.0, 
+					     	0.0, -s,  c,   0.0, 
+					     	0.0, 0.0, 0.0, 1.0
+					   };
+			matrix = Mat4(RX);
 		}
 		// Rotation on Y axis
 		else if ((x==0.0f) && (y==1.0f) && (z==0.0f))
 		{                    
-		    	float RY[] = {	c,   0.0, -s,  0.0, 
-				 	0.0, 1.0, 0.0, 0.0, 
-				 	s,   0.0, c,   0.0, 
-				 	0.0, 0.0, 0.0, 1.0
-				     };
-			R = RY;
+		    	const float RY[] = {	c,   0.0, -s,  0.0, 
+					 	0.0, 1.0, 0.0, 0.0, 
+					 	s,   0.0, c,   0.0, 
+					 	0.0, 0.0, 0.0, 1.0
+					   };
+			matrix = Mat4(RY);
 		}
 		// Rotation on Z axis
 		else if ((x==0.0f) && (y==0.0f) && (z==1.0f))
 		{                                          
-			float RZ[] = {	c,   s,   0.0, 0.0, 
-				     	-s,  c,   0.0, 0.0, 
-				     	0.0, 0.0, 1.0, 0.0, 
-				     	0.0, 0.0, 0.0, 1.0
-				     };
-			R = RZ;
+			const float RZ[] = {	c,   s,   0.0, 0.0, 
+					     	-s,  c,   0.0, 0.0, 
+					     	0.0, 0.0, 1.0, 0.0, 
+					     	0.0, 0.0, 0.0, 1.0
+					   };
+			matrix = Mat4(RZ);
 		}
 		// Rotation on non-standard axis
 		else
 		{
-			float ROther[] = {(1.0f-c)*(x*x-1.0f) + 1.0f, (1.0f-c)*x*y + (z*s),       (1.0f-c)*x*z - (y*s),       0.0f, 
-				      	  (1.0f-c)*x*y - (z*s),       (1.0f-c)*(y*y-1.0f) + 1.0f, (1.0f-c)*y*z + (x*s),       0.0f, 
-				      	  (1.0f-c)*x*z + (y*s),       (1.0f-c)*y*z - (x*s),       (1.0f-c)*(z*z-1.0f) + 1.0f, 0.0f, 
-				      	  0.0f,                       0.0f,                       0.0f,                       1.0f
-					 };
-			R = ROther;
+			const float ROther[] = {(1.0f-c)*(x*x-1.0f) + 1.0f, (1.0f-c)*x*y + (z*s),       (1.0f-c)*x*z - (y*s),       0.0f, 
+					      	(1.0f-c)*x*y - (z*s),       (1.0f-c)*(y*y-1.0f) + 1.0f, (1.0f-c)*y*z + (x*s),       0.0f, 
+					      	(1.0f-c)*x*z + (y*s),       (1.0f-c)*y*z - (x*s),       (1.0f-c)*(z*z-1.0f) + 1.0f, 0.0f, 
+					      	0.0f,                       0.0f,                       0.0f,                       1.0f
+					       };
+			matrix = Mat4(ROther);
 		}
-	
-		for(unsigned int i=0; i<16; ++i)
-			matrix[i] = R[i];
 	}
 
 	// Builds a perspective projection matrix and stores it in mat
@@ -170,19 +121,15 @@ namespace tool_geometry
 	// t = top,
 	// n = near,
 	// f = far in the frustum
-	const std::vector<float> setPerspective(const float l, const float r, const float b,
-						const float t, const float n, const float f)
+	const Mat4 setPerspective(const float l, const float r, const float b,
+				  const float t, const float n, const float f)
 	{
-		std::vector<float> mat;
-		float P[] = {	(2*n)/(r-l), 	0.0, 		0.0, 		0.0,
-			 	0.0, 		(2*n)/(t-b), 	0.0, 		0.0,
-			 	(r+l)/(r-l), 	(t+b)/(t-b), 	-(f+n)/(f-n), 	-1.0,
-			 	0.0, 		0.0, 		0.0, 		0.0
-			    };
-
-	    	for(unsigned int i=0 ; i<16 ; ++i)
-			mat.push_back(P[i]);
-		return mat;
+		const float P[] = {	(2*n)/(r-l), 	0.0, 		0.0, 		0.0,
+				 	0.0, 		(2*n)/(t-b), 	0.0, 		0.0,
+				 	(r+l)/(r-l), 	(t+b)/(t-b), 	-(f+n)/(f-n), 	-1.0,
+				 	0.0, 		0.0, 		0.0, 		0.0
+				  };
+		return Mat4(P);
 	}
 //namespace
 } 
@@ -250,23 +197,9 @@ namespace tool_camera
 	{
 		// Work variables
 		const float SPEED_MOVE = 0.25f;
-		std::vector<float> appFlags;
-		std::vector<float> cameraNewPos;
-		std::vector<float> inverseCameraPos;
-		std::vector<float> xAxis;
-		std::vector<float> yAxis;
-		// Initialize work vectors
-		for(unsigned int i=0; i<3; ++i)
-		{
-			appFlags.push_back(0.0f);
-			cameraNewPos.push_back(0.0f);
-			inverseCameraPos.push_back(0.0f);
-			xAxis.push_back(0.0f);
-			yAxis.push_back(0.0f);
-		}
-		// Initialize axis vectors
-		xAxis[0] = 1.0f;
-		yAxis[1] = 1.0f;
+		Vec3 appFlags;
+		const Vec3 xAxis(1.0f, 0.0f, 0.0f);
+		const Vec3 yAxis(0.0f, 1.0f, 0.0f);
 
 		// Manage the Z property
 		if(app.goingBackward() == app.goingForward())
@@ -289,6 +222,7 @@ namespace tool_camera
 		const float moveOnY = appFlags[1]*SPEED_MOVE;
 		const float moveOnZ = appFlags[2]*SPEED_MOVE;
 
+		Vec3 cameraNewPos;
 		for(unsigned int i=0; i<3; ++i)
 		{
 			cameraNewPos[i] = camera->position(i);
@@ -298,32 +232,21 @@ namespace tool_camera
 		}
 
 		// Translate by inverse of new camera position
-		for(unsigned int i=0; i<3; ++i)
-			inverseCameraPos[i] = -1.0f*cameraNewPos[i];
+		const Vec3 inverseCameraPos = -cameraNewPos;
 		// Get long and lat values
 		const float angleLong = app.xMousePosition() + M_PI;
 		const float angleLat = app.yMousePosition() + M_PI/2.0f;
 		
 
-		// Prepare matrices
-		std::vector<float> rotateAroundX;
-		std::vector<float> rotateAroundY;
-		std::vector<float> translate;
-		for(unsigned int i=0; i<16; ++i)
-		{
-			rotateAroundX.push_back(0.0f);
-			rotateAroundY.push_back(0.0f);
-			translate.push_back(0.0f);
-		}
 		// Compute operations matrices
+		Mat4 rotateAroundX;
+		Mat4 rotateAroundY;
+		Mat4 translate;
 		tool_geometry::setToRotate(rotateAroundX, -1.0f*angleLat, xAxis);
 		tool_geometry::setToRotate(rotateAroundY, angleLong, yAxis);
 		tool_geometry::setToTranslate(translate, inverseCameraPos);
 		// Compute new view matrix
-		tool_geometry::setToIdentity(camera->view());
-		tool_geometry::multMatrixBtoMatrixA(camera->view(), rotateAroundX);
-		tool_geometry::multMatrixBtoMatrixA(camera->view(), rotateAroundY);
-		tool_geometry::multMatrixBtoMatrixA(camera->view(), translate);
+		camera->view() = rotateAroundX * rotateAroundY * translate;
 
 		// Update camera values
 		for (unsigned int i=0 ; i<3 ; ++i)
@@ -341,41 +264,19 @@ namespace tool_camera
 	// Y and Z axis were wrong in lib3ds (confusion cause switched)
 	// http://lib3ds.sourceforge.net/lib3ds-1.2.0/doc/html/matrix_8c-source.html#l00403
 	// http://www.songho.ca/opengl/gl_transform.html#modelview
-	std::vector<float> lib3ds_matrix_camera_fixed(float* pos, float* tgt, float roll)
+	Mat4 lib3ds_matrix_camera_fixed(const Vec3& pos, const Vec3& tgt, float roll)
 	{
-		// Initialize needed matrices
-		std::vector<float> M;	// Target matrix
-		std::vector<float> R;	// Roll matrix
-		for(unsigned int i=0; i<16; ++i)
-		{
-			M.push_back(0.0f);
-			R.push_back(0.0f);
-		}
-
-		// Initialize needed camera vectors
-		std::vector<float> x;	// camera left vector
-		std::vector<float> y;	// camera up
-		std::vector<float> z;	// camera forward
-		for(unsigned int i=0; i<3; ++i)
-		{
-			x.push_back(0.0f);
-			y.push_back(0.0f);
-			z.push_back(0.0f);
-		}
-		y[1] = 1.0f;	// we can assume up here to be standard
-	
 		// Compute camera forward 
-		for(unsigned int i=0; i<3; ++i)
-			z[i] = pos[i] - tgt[i];
+		Vec3 z = pos - tgt;				// camera forward
 		tool_geometry::normalize(z);
 		// Compute camera up and left
-		x = tool_geometry::vectorProduct(z, y);
-		y = tool_geometry::vectorProduct(x, z);
+		Vec3 x = cross(z, Vec3(0.0f, 1.0f, 0.0f));	// camera left vector
+		Vec3 y = cross(x, z);				// camera up
 		tool_geometry::normalize(x);
 		tool_geometry::normalize(y);
 
 		// Target matrix
-		tool_geometry::setToIdentity(M);
+		Mat4 M;
 		M[0] = x[0];
 		M[1] = x[1];
 		M[2] = x[2];
@@ -387,10 +288,10 @@ namespace tool_camera
 		M[10] = z[2];
 
 		// Create the Roll matrix
-		tool_geometry::setToIdentity(R);
+		Mat4 R;
 		tool_geometry::setToRotate(R, -roll, z);
 		// Merge Target with Roll
-		tool_geometry::multMatrixBtoMatrixA(R, M);
+		R = R * M;
 		// Apply the camera Translate operation
 		for(unsigned int i=0; i<3; ++i)
 			R[12+i] = R[i]*(-pos[0]) + R[4+i]*(-pos[1]) + R[8+i]*(-pos[2]);
@@ -400,41 +301,19 @@ namespace tool_camera
 	// Helper : Fixed version of lib3ds_matrix_camera for Renderman
 	// As opposite to OpenGL the renderman camera transform is applied
 	// on all of the object of the scene. We need to apply the opposite transformation
-	std::vector<float> lib3ds_matrix_camera_renderman(float* pos, float* tgt, float roll)
+	Mat4 lib3ds_matrix_camera_renderman(const Vec3& pos, const Vec3& tgt, float roll)
 	{
-		// Initialize needed matrices
-		std::vector<float> M;	// Target matrix
-		std::vector<float> R;	// Roll matrix
-		for(unsigned int i=0; i<16; ++i)
-		{
-			M.push_back(0.0f);
-			R.push_back(0.0f);
-		}
-
-		// Initialize needed camera vectors
-		std::vector<float> x;	// camera left vector
-		std::vector<float> y;	// camera up
-		std::vector<float> z;	// camera forward
-		for(unsigned int i=0; i<3; ++i)
-		{
-			x.push_back(0.0f);
-			y.push_back(0.0f);
-			z.push_back(0.0f);
-		}
-		y[1] = 1.0f;	// we can assume up here to be standard
-	
 		// Compute camera forward 
-		for(unsigned int i=0; i<3; ++i)
-			z[i] = pos[i]-tgt[i];
+		Vec3 z = pos - tgt;				// camera forward
 		tool_geometry::normalize(z);
 		// Compute camera up and left
-		x = tool_geometry::vectorProduct(z, y);
-		y = tool_geometry::vectorProduct(x, z);
+		Vec3 x = cross(z, Vec3(0.0f, 1.0f, 0.0f));	// camera left vector
+		Vec3 y = cross(x, z);				// camera up
 		tool_geometry::normalize(x);
 		tool_geometry::normalize(y);
 
 		// Target matrix
-		tool_geometry::setToIdentity(M);
+		Mat4 M;
 		M[0] = -x[0];
 		M[1] = -x[1];
 		M[2] = -x[2];
@@ -445,15 +324,11 @@ namespace tool_camera
 		M[9] = -z[1];
 		M[10] = -z[2];
 
-		// Operate the Z rotation on revert axis
-		for(unsigned int i=0; i<3; ++i)
-			z[i] *= -1.0f;
-
-		// Create the Roll matrix
-		tool_geometry::setToIdentity(R);
-		tool_geometry::setToRotate(R, -roll, z);
+		// Create the Roll matrix, operate the Z rotation on revert axis
+		Mat4 R;
+		tool_geometry::setToRotate(R, -roll, -z);
 		// Merge Target with Roll
-		tool_geometry::multMatrixBtoMatrixA(R, M);
+		R = R * M;
 		// Apply the camera Translate operation
 		for(unsigned int i=0; i<3; ++i)
 			R[12+i] = R[i]*(-pos[0]) + R[4+i]*(-pos[1]) + R[8+i]*(-pos[2]);
@@ -461,7 +336,7 @@ namespace tool_camera
 	}
 
 	// Import camera modelview from 3ds file (OpenGL)
-	std::vector<float> getModelviewFrom3dsFile(const std::string& file)
+	Mat4 getModelviewFrom3dsFile(const std::string& file)
 	{
 		// Load camera from 3ds file
 		Lib3dsCamera * camera;
@@ -477,20 +352,20 @@ namespace tool_camera
 
 		// Lib3ds invert Y and Z axis for some reasons
 		// Need to fix the value providen
-		float position_fixed[3];
-		position_fixed[0] = camera->position[0] /100.0f;
-		position_fixed[2] = camera->position[1] /100.0f;
-		position_fixed[1] = camera->position[2] /100.0f;
-		float target_fixed[3];
-		target_fixed[0] = camera->target[0] /100.0f;
-		target_fixed[2] = camera->target[1] /100.0f;
-		target_fixed[1] = camera->target[2] /100.0f;
-
-		return lib3ds_matrix_camera_fixed(position_fixed, target_fixed, camera->roll);
+		const Vec3 position_fixed(camera->position[0] /100.0f, \
+					  camera->position[2] /100.0f, \
+					  camera->position[1] /100.0f);
+		const Vec3 target_fixed(camera->target[0] /100.0f, \
+					camera->target[2] /100.0f, \
+					camera->target[1] /100.0f);
+
+		const float roll = camera->roll;
+		lib3ds_file_free(l_file);
+		return lib3ds_matrix_camera_fixed(position_fixed, target_fixed, roll);
 	}
 
 	// Import camera tranform from 3ds file (Renderman)
-	std::vector<float> getRendermanTransformFrom3dsFile(const std::string& file)
+	Mat4 getRendermanTransformFrom3dsFile(const std::string& file)
 	{
 		// Load camera from 3ds file
 		Lib3dsCamera * camera;
@@ -506,16 +381,16 @@ namespace tool_camera
 
 		// Lib3ds invert Y and Z axis for some reasons
 		// Need to fix the value providen
-		float position_fixed[3];
-		position_fixed[0] = camera->position[0] /100.0f;
-		position_fixed[2] = camera->position[1] /100.0f;
-		position_fixed[1] = camera->position[2] /100.0f;
-		float target_fixed[3];
-		target_fixed[0] = camera->target[0] /100.0f;
-		target_fixed[2] = camera->target[1] /100.0f;
-		target_fixed[1] = camera->target[2] /100.0f;
-
-		return lib3ds_matrix_camera_renderman(position_fixed, target_fixed, camera->roll);
+		const Vec3 position_fixed(camera->position[0] /100.0f, \
+					  camera->position[2] /100.0f, \
+					  camera->position[1] /100.0f);
+		const Vec3 target_fixed(camera->target[0] /100.0f, \
+					camera->target[2] /100.0f, \
+					camera->target[1] /100.0f);
+
+		const float roll = camera->roll;
+		lib3ds_file_free(l_file);
+		return lib3ds_matrix_camera_renderman(position_fixed, target_fixed, roll);
 	}
 // namespace
 }
@@ -553,36 +428,108 @@ namespace tool_filesystem
 		}
 		return l_file;
 	}
+
+	// Create a directory and its parents (no shell : any character is allowed)
+	// Returns false if a directory can not be made
+	bool makeDirectories(const std::string& path)
+	{
+		// One component after the other, the existing ones are kept
+		std::string::size_type end = 0;
+		while(end != std::string::npos)
+		{
+			end = path.find('/', end + 1);
+			const std::string directory = path.substr(0, end);
+			if(directory.empty() || directory == "/")
+				continue;
+			if(mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+			{
+				std::cout << "WARNING unable to create the directory " << directory \
+					  << " (" << strerror(errno) << ")" << std::endl;
+				return false;
+			}
+		}
+		return true;
+	}
 // namespace
 }
 
 namespace tool_renderman
 {
+	// Default render settings
+	RenderSettings defaultRenderSettings()
+	{
+		RenderSettings settings;
+		settings.outputRoot = "/home/robin/Bureau/Render";
+		settings.xResolution = 1280;
+		settings.yResolution = 720;
+		settings.pixelSamples = 4.0f;
+		settings.fov = 45.0f;
+		settings.passes = PASS_ALL;
+		settings.encoding = RibWriter::ASCII;
+		settings.compressed = false;
+		settings.boidsPrimitive = BOIDS_SPHERES;
+		return settings;
+	}
+
+	// Current render settings
+	static RenderSettings s_settings = defaultRenderSettings();
+
+	// Get/set the render settings
+	const RenderSettings& renderSettings()
+	{
+		return s_settings;
+	}
+
+	void setRenderSettings(const RenderSettings& settings)
+	{
+		s_settings = settings;
+	}
+
 	// Construct a RIB file name 
 	std::string _getRIBFile(const std::string name, const unsigned int frame, const std::string label)
 	{
-		std::string returnValue = "/home/robin/Bureau/Render/rib/" + name + "/";
+		std::string returnValue = s_settings.outputRoot + "/rib/" + name + "/";
 		if(label != "")
 			returnValue += label + "/";
 		// Create directory if does not exist
-		std::string commandDirectory = "mkdir -p " + returnValue;
-		system(commandDirectory.c_str());
+		tool_filesystem::makeDirectories(returnValue);
 		// Add frame number pad 4
 		std::ostringstream oss;
 		oss << std::setfill('0') << std::setw(4) << frame;
 		returnValue += "rib." + oss.str() + ".rib";
+		if(s_settings.compressed)
+			returnValue += ".gz";
+		return returnValue;
+	}
+
+	// Construct a geometry archive file name (shared by the frames with the same geometry)
+	// The directory is not created (see _getArchiveDirectory)
+	std::string _getArchiveFile(const std::string name, const uint64_t hash)
+	{
+		std::string returnValue = _getArchiveDirectory(name);
+		// Add the geometry hash
+		std::ostringstream oss;
+		oss << std::hex << std::setfill('0') << std::setw(16) << hash;
+		returnValue += "geo." + oss.str() + ".rib";
+		if(s_settings.compressed)
+			returnValue += ".gz";
 		return returnValue;
 	}
 
+	// Construct the geometry archive directory of a figure
+	std::string _getArchiveDirectory(const std::string name)
+	{
+		return s_settings.outputRoot + "/rib/" + name + "/geometry/";
+	}
+
 	// Construct a TiFF file name
 	std::string _getTIFFFile(const std::string name, const unsigned int frame, const std::string label)
 	{
-		std::string returnValue = "/home/robin/Bureau/Render/images/" + name + "/";
+		std::string returnValue = s_settings.outputRoot + "/images/" + name + "/";
 		if(label != "")
 			returnValue += label + "/";
 		// Create directory if does not exist
-		std::string commandDirectory = "mkdir -p " + returnValue;
-		system(commandDirectory.c_str());
+		tool_filesystem::makeDirectories(returnValue);
 		// Add frame number pad 4
 		std::ostringstream oss;
 		oss << std::setfill('0') << std::setw(4) << frame;
@@ -591,151 +538,318 @@ namespace tool_renderman
 	}
 
 	// Convert an OpenGL camera to Renderman camera
-	void _convertMatrixToRtMatrix(const std::vector<float>& matrix, RtMatrix converted)
+	void _convertMatrixToRtMatrix(const Mat4& matrix, RibMatrix converted)
 	{
-		for(unsigned int k=0; k<4; ++k)
-		{
-			for(unsigned int l=0; l<4; ++l)
-				converted[k][l] = 0;
-		}
-		unsigned int i = 0;
-		unsigned int j = 0;
+		// Column-major OpenGL layout is the row-major
+		// layout of the transposed Renderman matrix
 		for(unsigned int indice = 0; indice<16; ++indice)
-		{
-			if(j == 4)
-			{
-				++i;
-				j=0;
-			}
-			converted[i][j] = matrix.at(indice);
-			++j;
-		}
+			converted[indice/4][indice%4] = matrix[indice];
 	}
 
 	// Generate RIB file header
 	void generateRIBHeader( \
+		RibWriter& rib, \
 		const std::string name, \
 		const unsigned int frame, \
-		const std::vector<float> camera, \
+		const Mat4& camera, \
 		const std::string label \
 	)
 	{
 		std::string ribFile = _getRIBFile(name, frame, label);
 		std::string tiffFile = _getTIFFFile(name, frame, label);
 		// Create Rib file header
-		RiBegin(ribFile.c_str());
-		RiDisplay(tiffFile.c_str(), RI_FILE, RI_RGB, RI_NULL);
-		RiFormat(RtInt(1280), RtInt(720), 1.0f);
-		RtFloat fov(45.0f);
-		RiProjection("perspective", RI_FOV, &fov, RI_NULL);
+		rib.begin(ribFile, s_settings.encoding, s_settings.compressed);
+		rib.display(tiffFile, "file", "rgb");
+		rib.format(s_settings.xResolution, s_settings.yResolution, 1.0f);
+		rib.projection("perspective", RibParams().add("fov", s_settings.fov));
 		// Convert Camera from OpenGL to Renderman
-		RtMatrix renderCamera;
+		RibMatrix renderCamera;
 		_convertMatrixToRtMatrix(camera, renderCamera);
-		RiTransform(renderCamera);
-		RiPixelSamples(RtFloat(4.0f), RtFloat(4.0f));
+		rib.transform(renderCamera);
+		rib.pixelSamples(s_settings.pixelSamples, s_settings.pixelSamples);
 	}
 
 	// Generate RIB file footer
-	void generateRIBFileFooter()
+	void generateRIBFileFooter(RibWriter& rib)
 	{
-		RiWorldEnd();
-		RiEnd();
+		rib.worldEnd();
+		rib.end();
+	}
+
+	// World space frustum of a renderman camera transform
+	// Renderman camera space looks down +z, the fov is on the smaller image side
+	Frustum cameraFrustum(const Mat4& camera)
+	{
+		const float n = 0.001f;
+		const float f = 100000.0f;
+		const float tanFov = cameraTanHalfFov();
+		float tanX = tanFov;
+		float tanY = tanFov;
+		if(s_settings.xResolution > s_settings.yResolution)
+			tanX *= (float)s_settings.xResolution / (float)s_settings.yResolution;
+		else
+			tanY *= (float)s_settings.yResolution / (float)s_settings.xResolution;
+		const float P[] = {	1.0f/tanX, 0.0f,      0.0f,               0.0f,
+					0.0f,      1.0f/tanY, 0.0f,               0.0f,
+					0.0f,      0.0f,      (f+n)/(f-n),        1.0f,
+					0.0f,      0.0f,      -(2.0f*f*n)/(f-n),  0.0f
+				  };
+		return Frustum(Mat4(P) * camera);
+	}
+
+	// Tangent of half the renderman fov (on the smaller image side)
+	float cameraTanHalfFov()
+	{
+		return tan(s_settings.fov * M_PI / 360.0f);
+	}
+
+	// Radius of the sphere exported for a boid
+	float boidRadius(const float size)
+	{
+		return 0.01f + (size * 0.0025f);
 	}
 
 	// Render one boid to renderman
-	void renderOneBoid(const Boid& b)
+	void renderOneBoid(RibWriter& rib, const float* position, const float size, const float intensity,
+			   const float radiusScale)
+	{
+		const float x = position[0];
+		const float y = position[1];
+		const float z = position[2];
+		const float radius = boidRadius(size) * radiusScale;
+		const float  kd = 0.5f + intensity * 0.5f;
+
+		rib.attributeBegin();
+		rib.translate(x, y, z);
+		rib.surface("star_core", RibParams().add("Kd", kd));
+		rib.sphere(radius, 0.0f, 0.5f, 360.0f);
+		rib.attributeEnd();
+	}
+
+	// Render all of the boids of a job to renderman
+	void renderBoids(RibWriter& rib, const RenderJob& job)
 	{
-		const float x = b.position(0);
-		const float y = b.position(1);
-		const float z = b.position(2);
-		const float size = 0.01f + (b.size() * 0.0025f);
-		const float  intensity = 0.5f + b.intensity() * 0.5f;
+		const unsigned int nbBoids = job.sizes.size();
+		if(s_settings.boidsPrimitive == BOIDS_SPHERES)
+		{
+			for(unsigned int i=0; i<nbBoids; ++i)
+				renderOneBoid(rib, &job.positions[3*i], job.sizes[i], job.intensities[i], job.radiusScale);
+			return;
+		}
+		if(nbBoids == 0)
+			return;
+
+		// Single Points primitive : same size and intensity
+		// as renderOneBoid, given as per point primvars
+		// (scratch arrays of the writer thread, given back after the pass)
+		FrameArena& arena = FrameArena::local();
+		float * widths = arena.alloc<float>(nbBoids);
+		float * intensities = arena.alloc<float>(nbBoids);
+		for(unsigned int i=0; i<nbBoids; ++i)
+		{
+			widths[i] = 2.0f * boidRadius(job.sizes[i]) * job.radiusScale;
+			intensities[i] = 0.5f + job.intensities[i] * 0.5f;
+		}
 
-		RiAttributeBegin();
-		RiTranslate(x, y, z);
-		RtFloat kr = intensity;
-		RiSurface("star_core","Kd",&kr,RI_NULL);
-		RiSphere(size, 0.0f, 0.5f, 360.0f, RI_NULL);
-		RiAttributeEnd();
+		rib.attributeBegin();
+		rib.surface("star_core");
+		rib.points(RibParams() \
+			.addArray("P", &job.positions[0], job.positions.size()) \
+			.addArray("width", widths, nbBoids) \
+			.addArray("varying float Kd", intensities, nbBoids));
+		rib.attributeEnd();
 	}
 
 	// Create the renderman attribute for a matte pass
-	void shadeMeshMattePass()
+	void shadeMeshMattePass(RibWriter& rib)
 	{
-		RiAttributeBegin();
-		RtFloat displacementbound = 3.0f;
-		const char* coord = "world";
-		RiAttribute("displacementbound", "sphere", &displacementbound, \
-		"coordinatesystem", &(coord), RI_NULL);
-		RiDisplacement("robin_mesh", RI_NULL);
-		RiSurface("robin_mesh_matte", RI_NULL);
+		rib.attributeBegin();
+		rib.attribute("displacementbound", RibParams() \
+			.add("sphere", MESH_DISPLACEMENT_BOUND) \
+			.add("coordinatesystem", "world"));
+		rib.displacement("robin_mesh");
+		rib.surface("robin_mesh_matte");
 	}
 
 	// Create the renderman attribute for a reflect pass
-	void shadeMeshReflectPass()
+	void shadeMeshReflectPass(RibWriter& rib)
 	{
-		RiAttributeBegin();
-		RtFloat displacementbound = 3.0f;
-		const char* coord = "world";
-		RiAttribute("displacementbound", "sphere", &displacementbound, \
-		"coordinatesystem", &(coord), RI_NULL);
-		RiDisplacement("robin_mesh", RI_NULL);
-		RiSurface("robin_mesh_color", RI_NULL);
+		rib.attributeBegin();
+		rib.attribute("displacementbound", RibParams() \
+			.add("sphere", MESH_DISPLACEMENT_BOUND) \
+			.add("coordinatesystem", "world"));
+		rib.displacement("robin_mesh");
+		rib.surface("robin_mesh_color");
 	}
 
 	// Create the renderman attribute for a skin pass
-	void shadeMeshSkinPass()
+	void shadeMeshSkinPass(RibWriter& rib)
 	{
-		RiAttributeBegin();
-		RtFloat displacementbound = 3.0f;
-		const char* coord = "world";
-		RiAttribute("displacementbound", "sphere", &displacementbound, \
-		"coordinatesystem", &(coord), RI_NULL);
-		RiDisplacement("robin_mesh", RI_NULL);
-		RiSurface("robin_mesh_skin", RI_NULL);
+		rib.attributeBegin();
+		rib.attribute("displacementbound", RibParams() \
+			.add("sphere", MESH_DISPLACEMENT_BOUND) \
+			.add("coordinatesystem", "world"));
+		rib.displacement("robin_mesh");
+		rib.surface("robin_mesh_skin");
 	}
 
 	// Render one mesh to renderman
-	void renderMesh(const std::vector<float>& mesh)
+	// vertices : welded points (x,y,z), indices : 3 per triangle
+	void renderMesh(RibWriter& rib, const std::vector<float>& vertices, const std::vector<int>& indices)
 	{
 		// Create a polygone from the mesh
 		// Create the pointPerFace array (always  3 for each face)
-		const int totalFaces = mesh.size()/9;
-		RtInt pointPerFace[totalFaces];
-		for(int i = 0; i<totalFaces; ++i)
-			pointPerFace[i] = 3;
-		// Usual parameters
-		RtToken boundary[] = {"interpolateboundary"};
-		RtInt nbIndiceTag[] = {0,0};
-		// Indices array
-		RtInt indices[mesh.size()];
-		for(unsigned int i=0; i< mesh.size()/3; ++i)
-			indices[i] = (RtInt) i;
-		// Vertex array
-		RtFloat vertices[mesh.size()];
-		for(unsigned int idx = 0; idx<mesh.size(); ++idx)
-			vertices[idx] = RtFloat(mesh[idx]);
-
-		RiSubdivisionMesh( \
-			"catmull-clark", \
-			(RtInt)totalFaces, \
-			pointPerFace, \
-			indices, \
-			1, \
-			boundary, \
-			nbIndiceTag, \
-			NULL, NULL, \
-			"P", vertices, \
-			RI_NULL \
-		);
-		RiAttributeEnd();
+		const int totalFaces = indices.size()/3;
+		if(totalFaces > 0)
+		{
+			int * pointPerFace = FrameArena::local().alloc<int>(totalFaces);
+			for(int i = 0; i<totalFaces; ++i)
+				pointPerFace[i] = 3;
+			// Usual parameters
+			std::string boundary[] = {"interpolateboundary"};
+			int nbIndiceTag[] = {0,0};
+
+			rib.subdivisionMesh( \
+				"catmull-clark", \
+				totalFaces, \
+				pointPerFace, \
+				&indices[0], \
+				1, \
+				boundary, \
+				nbIndiceTag, \
+				NULL, NULL, \
+				RibParams().addArray("P", &vertices[0], vertices.size()) \
+			);
+		}
+	}
+
+	// Content hash of a welded mesh (FNV-1a on 32 bits words)
+	uint64_t hashGeometry(const std::vector<float>& vertices, const std::vector<int>& indices)
+	{
+		const uint64_t prime = 1099511628211ULL;
+		uint64_t hash = 14695981039346656037ULL;
+		for(unsigned int i=0; i<vertices.size(); ++i)
+		{
+			uint32_t word;
+			memcpy(&word, &vertices[i], sizeof(word));
+			hash = (hash ^ word) * prime;
+		}
+		for(unsigned int i=0; i<indices.size(); ++i)
+			hash = (hash ^ (uint32_t)indices[i]) * prime;
+		return hash;
+	}
+
+	// Get the mask of passes to write for a figure snapshot
+	unsigned int jobPasses(const RenderJob& job)
+	{
+		if(!job.isMesh)
+			return s_settings.passes & PASS_BOIDS;
+		unsigned int passes = s_settings.passes & PASS_ALL;
+		// Mesh geometry goes to an archive read by the mesh passes
+		// (not needed while the mesh is out of the camera)
+		if(job.visible && (passes & (PASS_MATTE | PASS_SKIN | PASS_REFLECT)))
+			passes |= PASS_GEOMETRY;
+		return passes;
+	}
+
+	// Place the figure in the world (nothing written for the identity)
+	static void _concatFigureTransform(RibWriter& rib, const RenderJob& job)
+	{
+		if(memcmp(job.transform.data(), Mat4().data(), sizeof(Mat4)) == 0)
+			return;
+		RibMatrix transform;
+		_convertMatrixToRtMatrix(job.transform, transform);
+		rib.concatTransform(transform);
+	}
+
+	// Render the mesh of a pass and close the pass attributes
+	static void _renderPassMesh(RibWriter& rib, const RenderJob& job)
+	{
+		if(job.visible)
+		{
+			_concatFigureTransform(rib, job);
+			rib.readArchive(_getArchiveFile(job.name, job.geometryHash));
+		}
+		rib.attributeEnd();
+	}
+
+	// Write one pass of a figure snapshot (passes are independent files)
+	void renderPass(const RenderJob& job, const RenderPass pass)
+	{
+		RibWriter rib;
+		switch(pass)
+		{
+			// Mesh geometry shared by the other passes
+			case PASS_GEOMETRY :
+				rib.begin(_getArchiveFile(job.name, job.geometryHash), \
+					s_settings.encoding, s_settings.compressed);
+				renderMesh(rib, job.vertices, job.indices);
+				rib.end();
+				break;
+
+			// Matte Pass
+			case PASS_MATTE :
+				generateRIBHeader(rib, job.name + "_matte", job.frame, job.camera);
+				rib.worldBegin();
+				shadeMeshMattePass(rib);
+				_renderPassMesh(rib, job);
+				generateRIBFileFooter(rib);
+				break;
+
+			// Skin Pass
+			case PASS_SKIN :
+				generateRIBHeader(rib, job.name + "_skin", job.frame, job.camera);
+				rib.worldBegin();
+				rib.lightSource("distantlight", RibParams().add("intensity", 1.0f));
+				shadeMeshSkinPass(rib);
+				_renderPassMesh(rib, job);
+				generateRIBFileFooter(rib);
+				break;
+
+			// Reflect Pass
+			case PASS_REFLECT :
+				generateRIBHeader(rib, job.name + "_refect", job.frame, job.camera);
+				rib.worldBegin();
+				shadeMeshReflectPass(rib);
+				_renderPassMesh(rib, job);
+				generateRIBFileFooter(rib);
+				break;
+
+			// Boids pass (the only one for figures which are not meshes)
+			case PASS_BOIDS :
+				if(job.isMesh)
+					generateRIBHeader(rib, job.name + "_boids", job.frame, job.camera);
+				else
+					generateRIBHeader(rib, job.name, job.frame, job.camera);
+				// Render specific for figures
+				rib.worldBegin();
+				rib.attributeBegin();
+				_concatFigureTransform(rib, job);
+				renderBoids(rib, job);
+				rib.attributeEnd();
+				generateRIBFileFooter(rib);
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	// Write the given passes of a figure snapshot
+	void renderPasses(const RenderJob& job, const unsigned int passes)
+	{
+		for(unsigned int pass=PASS_MATTE; pass<=PASS_GEOMETRY; pass <<= 1)
+		{
+			if(passes & pass)
+				renderPass(job, (RenderPass)pass);
+		}
 	}
 }
 
 namespace tool_debug
 {
 	//Print a matrix on shell
-	void printMatrix(const std::vector<float> matrix)
+	void printMatrix(const Mat4& matrix)
 	{
 		std::cout << "" << std::endl;
 		for(unsigned int i=0; i<16; i+=4)
@@ -3,30 +3,31 @@
 
 #include "Application.hpp"
 #include "Camera.hpp"
+#include "Matrix.hpp"
 
 #include <lib3ds.h>
 #include <string>
 #include <vector>
-#include <ri.h>
+
+#include "RibWriter.hpp"
+#include "RenderQueue.hpp"
 
 namespace tool_geometry
 {
 	// To normalize a vector
-	void normalize (std::vector<float>& v);
+	void normalize (Vec3& v);
 	// To get the vector product
-	const std::vector<float> vectorProduct (const std::vector<float>& a,
-						const std::vector<float>& b);
+	const Vec3 vectorProduct (const Vec3& a, const Vec3& b);
 	// Does the multiplication A=A*B : all the matrices are described column-major
-	void multMatrixBtoMatrixA(std::vector<float>& A, const std::vector<float>& B);
+	void multMatrixBtoMatrixA(Mat4& A, const Mat4& B);
 	// Sets the provided matrix to identity
-	void setToIdentity(std::vector<float>& matrix);
+	void setToIdentity(Mat4& matrix);
 	// Sets the provided matrix to a translate matrix on vector t
-	void setToTranslate(std::vector<float>& matrix, const std::vector<float>& t);
+	void setToTranslate(Mat4& matrix, const Vec3& t);
 	// Sets the provided matrix to a scale matrix by coeficients in s
-	void setToScale(std::vector<float>& matrix, const std::vector<float>& s);
+	void setToScale(Mat4& matrix, const Vec3& s);
 	// Sets the provided matrix to a rotate matrix of angle "angle", around axis "axis"
-	void setToRotate(std::vector<float>& matrix, const float angle,
-						     const std::vector<float>& axis);
+	void setToRotate(Mat4& matrix, const float angle, const Vec3& axis);
 	// Builds a perspective projection matrix and stores it in mat
 	// l = left,
 	// r = right,
@@ -34,8 +35,8 @@ namespace tool_geometry
 	// t = top,
 	// n = near,
 	// f = far in the frustum
-	const std::vector<float> setPerspective(const float l, const float r, const float b,
-						const float t, const float n, const float f);
+	const Mat4 setPerspective(const float l, const float r, const float b,
+				  const float t, const float n, const float f);
 }
 
 namespace tool_camera
@@ -47,9 +48,9 @@ namespace tool_camera
 	// Update the camera values according to keyboard, mouse
 	void manageFps(const Application& app, Camera * camera);
 	// Import camera modelview from 3ds file (OpenGL)
-	std::vector<float> getModelviewFrom3dsFile(const std::string& file);
+	Mat4 getModelviewFrom3dsFile(const std::string& file);
 	// Import camera tranform from 3ds file (Renderman)
-	std::vector<float> getRendermanTransformFrom3dsFile(const std::string& file);
+	Mat4 getRendermanTransformFrom3dsFile(const std::string& file);
 }
 
 namespace tool_filesystem
@@ -60,41 +61,110 @@ namespace tool_filesystem
 	std::vector<std::string> brute_open3dsFiles(const std::string& path, const int start_seq, const int end_seq);
 	// Import 3ds file with lib3ds and check it
 	Lib3dsFile * open3dsFile(const std::string& file);
+	// Create a directory and its parents (no shell : any character is allowed)
+	// Returns false if a directory can not be made
+	bool makeDirectories(const std::string& path);
 }
 
 namespace tool_renderman
 {
+	// Primitive used to export the boids
+	enum BoidsPrimitive
+	{
+		BOIDS_SPHERES,		// one sphere per boid
+		BOIDS_POINTS		// one Points primitive per figure
+	};
+
+	// Render passes (combined as a mask)
+	enum RenderPass
+	{
+		PASS_MATTE = 1,
+		PASS_SKIN = 2,
+		PASS_REFLECT = 4,
+		PASS_BOIDS = 8,
+		PASS_ALL = 15,
+		PASS_GEOMETRY = 16	// mesh archive read by the mesh passes
+	};
+
+	// Options of the generated RIB files (<render> node of the scene)
+	typedef struct
+	{
+		std::string outputRoot;		// root of the rib/ and images/ directories
+		int xResolution;		// image width
+		int yResolution;		// image height
+		float pixelSamples;		// pixel samples on x and y
+		float fov;			// field of view (degrees)
+		unsigned int passes;		// mask of RenderPass to write
+		RibWriter::Encoding encoding;	// ASCII or BINARY RIB
+		bool compressed;		// gzip the RIB files
+		BoidsPrimitive boidsPrimitive;	// primitive used to export the boids
+	}
+	RenderSettings;
+
+	// Displacement bound of the mesh shaders (world space)
+	const float MESH_DISPLACEMENT_BOUND = 3.0f;
+
+	// Default render settings
+	RenderSettings defaultRenderSettings();
+	// Get/set the render settings
+	const RenderSettings& renderSettings();
+	void setRenderSettings(const RenderSettings& settings);
 	// Construct a RIB file name 
 	std::string _getRIBFile(const std::string name, const unsigned int frame, const std::string label="");
+	// Construct a geometry archive file name (shared by the frames with the same geometry)
+	// The directory is not created (see _getArchiveDirectory)
+	std::string _getArchiveFile(const std::string name, const uint64_t hash);
+	// Construct the geometry archive directory of a figure
+	std::string _getArchiveDirectory(const std::string name);
 	// Construct a TiFF file name
 	std::string _getTIFFFile(const std::string name, const unsigned int frame, const std::string label="");
 	// Convert an OpenGL camera to Renderman camera
-	void _convertMatrixToRtMatrix(const std::vector<float>& matrix, RtMatrix converted);
+	void _convertMatrixToRtMatrix(const Mat4& matrix, RibMatrix converted);
 	// Generate RIB file header
 	void generateRIBHeader( \
+		RibWriter& rib, \
 		const std::string name, \
 		const unsigned int frame, \
-		const std::vector<float> camera, \
+		const Mat4& camera, \
 		const std::string label="" \
 	);
 	// Generate RIB file footer
-	void generateRIBFileFooter();
+	void generateRIBFileFooter(RibWriter& rib);
+	// World space frustum of a renderman camera transform
+	Frustum cameraFrustum(const Mat4& camera);
+	// Tangent of half the renderman fov (on the smaller image side)
+	float cameraTanHalfFov();
+	// Radius of the sphere exported for a boid
+	float boidRadius(const float size);
 	// Render one boid to renderman
-	void renderOneBoid(const Boid& b);
+	// radiusScale : LOD compensation of the decimated boids
+	void renderOneBoid(RibWriter& rib, const float* position, const float size, const float intensity,
+			   const float radiusScale=1.0f);
+	// Render all of the boids of a job to renderman
+	void renderBoids(RibWriter& rib, const RenderJob& job);
 	// Create the renderman attribute for a skin pass
-	void shadeMeshSkinPass();
+	void shadeMeshSkinPass(RibWriter& rib);
 	// Create the renderman attribute for a reflect pass
-	void shadeMeshReflectPass();
+	void shadeMeshReflectPass(RibWriter& rib);
 	// Create the renderman attribute for a matte pass
-	void shadeMeshMattePass();
+	void shadeMeshMattePass(RibWriter& rib);
 	// Render one mesh to renderman
-	void renderMesh(const std::vector<float>& mesh);
+	// vertices : welded points (x,y,z), indices : 3 per triangle
+	void renderMesh(RibWriter& rib, const std::vector<float>& vertices, const std::vector<int>& indices);
+	// Content hash of a welded mesh
+	uint64_t hashGeometry(const std::vector<float>& vertices, const std::vector<int>& indices);
+	// Get the mask of passes to write for a figure snapshot
+	unsigned int jobPasses(const RenderJob& job);
+	// Write one pass of a figure snapshot (passes are independent files)
+	void renderPass(const RenderJob& job, const RenderPass pass);
+	// Write the given passes of a figure snapshot
+	void renderPasses(const RenderJob& job, const unsigned int passes);
 }
 
 namespace tool_debug
 {
 	//Print a matrix on shell
-	void printMatrix(const std::vector<float> matrix);
+	void printMatrix(const Mat4& matrix);
 }
 
 #endif //  __TOOLS_HPP__
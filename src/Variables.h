@@ -14,8 +14,11 @@
 #include <cmath>
 
 //EVENT LOOP MANAGEMENT 
-const int MY_RENDER_LOOP = 1 ;
-const int FREE_REFRESH_LOOP = 10 ;
+const Uint32 FRAME_PERIOD = 41 ;		// ms between simulation steps (24 fps)
+const Uint32 REFRESH_PERIOD = 80 ;		// ms between FPS camera refreshes
+const unsigned int MAX_CATCHUP_STEPS = 4 ;	// late steps run before restarting the clock
+const int FREE_REFRESH_LOOP = 10 ;		// frames between removals of the empty figures
+const int MEMORY_REFRESH_LOOP = 24 ;		// frames between updates of the memory shown in the window title
 
 // Scene
 #define COL_BLACK 0
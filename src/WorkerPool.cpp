@@ -0,0 +1,114 @@
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+#include <unistd.h>
+
+WorkerPool * WorkerPool::s_shared = NULL;
+
+// Builder
+WorkerPool::WorkerPool(const unsigned int nbWorkers):
+m_task(NULL),
+m_data(NULL),
+m_nbItems(0),
+m_grain(1),
+m_nextItem(0),
+m_nbDone(0),
+m_stop(false)
+{
+	m_mutex = SDL_CreateMutex();
+	m_rangesPushed = SDL_CreateCond();
+	m_rangesDone = SDL_CreateCond();
+	for(unsigned int i=0; i<nbWorkers; ++i)
+		m_workers.push_back(SDL_CreateThread(_workerLoop, this));
+}
+
+WorkerPool::~WorkerPool()
+{
+	SDL_LockMutex(m_mutex);
+	m_stop = true;
+	SDL_CondBroadcast(m_rangesPushed);
+	SDL_UnlockMutex(m_mutex);
+	for(unsigned int i=0; i<m_workers.size(); ++i)
+		SDL_WaitThread(m_workers[i], NULL);
+	SDL_DestroyCond(m_rangesPushed);
+	SDL_DestroyCond(m_rangesDone);
+	SDL_DestroyMutex(m_mutex);
+}
+
+// Run task on the items [0, nbItems), by ranges of grain items
+// The calling thread works too, returns once every item is done
+void WorkerPool::run(RangeTask task, void* data, const unsigned int nbItems, const unsigned int grain)
+{
+	// Small loop : not worth waking the workers
+	if(m_workers.empty() || nbItems <= grain)
+	{
+		task(data, 0, nbItems);
+		return;
+	}
+	SDL_LockMutex(m_mutex);
+	m_task = task;
+	m_data = data;
+	m_nbItems = nbItems;
+	m_grain = std::max(grain, 1u);
+	m_nextItem = 0;
+	m_nbDone = 0;
+	SDL_CondBroadcast(m_rangesPushed);
+	_runRanges();
+	while(m_nbDone < m_nbItems)
+		SDL_CondWait(m_rangesDone, m_mutex);
+	SDL_UnlockMutex(m_mutex);
+}
+
+// Pool of the simulation (one worker per other core, made on first use)
+WorkerPool& WorkerPool::shared()
+{
+	if(s_shared == NULL)
+	{
+		const long nbCores = sysconf(_SC_NPROCESSORS_ONLN);
+		s_shared = new WorkerPool((nbCores > 1) ? (unsigned int)(nbCores - 1) : 0);
+	}
+	return *s_shared;
+}
+
+// Stop the pool of the simulation
+void WorkerPool::releaseShared()
+{
+	delete s_shared;
+	s_shared = NULL;
+}
+
+// Worker thread entry point
+int WorkerPool::_workerLoop(void* pool)
+{
+	WorkerPool* self = (WorkerPool*) pool;
+	SDL_LockMutex(self->m_mutex);
+	while(true)
+	{
+		while(!self->m_stop && self->m_nextItem >= self->m_nbItems)
+			SDL_CondWait(self->m_rangesPushed, self->m_mutex);
+		if(self->m_stop)
+			break;
+		self->_runRanges();
+	}
+	SDL_UnlockMutex(self->m_mutex);
+	return 0;
+}
+
+// Take and run ranges until none is left (mutex locked)
+void WorkerPool::_runRanges()
+{
+	while(m_nextItem < m_nbItems)
+	{
+		const unsigned int begin = m_nextItem;
+		const unsigned int end = std::min(begin + m_grain, m_nbItems);
+		m_nextItem = end;
+		RangeTask task = m_task;
+		void* data = m_data;
+		SDL_UnlockMutex(m_mutex);
+		task(data, begin, end);
+		SDL_LockMutex(m_mutex);
+		m_nbDone += end - begin;
+		if(m_nbDone == m_nbItems)
+			SDL_CondBroadcast(m_rangesDone);
+	}
+}
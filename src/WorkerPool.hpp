@@ -0,0 +1,53 @@
+// Data parallel loops on SDL threads : the items of a loop are split in
+// ranges, taken by the workers and the calling thread until none is left.
+
+#ifndef __WORKERPOOL_HPP__
+#define __WORKERPOOL_HPP__
+
+#include <SDL.h>
+#include <vector>
+
+// Work on the items [begin, end) of data
+typedef void (*RangeTask)(void* data, const unsigned int begin, const unsigned int end);
+
+class WorkerPool
+{
+private :
+	std::vector<SDL_Thread*> m_workers;	// worker threads (none : run() works alone)
+	SDL_mutex * m_mutex;			// protects all of the members below
+	SDL_cond * m_rangesPushed;		// signaled when a loop starts
+	SDL_cond * m_rangesDone;		// signaled when the last range of a loop ends
+	RangeTask m_task;			// current loop
+	void * m_data;
+	unsigned int m_nbItems;			// items of the current loop
+	unsigned int m_grain;			// items per range
+	unsigned int m_nextItem;		// first item not taken yet
+	unsigned int m_nbDone;			// items done
+	bool m_stop;				// set to true to end the workers
+	static WorkerPool * s_shared;		// pool of the simulation
+
+public :
+	// Builder
+	// nbWorkers : threads added to the calling one
+	WorkerPool(const unsigned int nbWorkers);
+	~WorkerPool();
+
+	// Run task on the items [0, nbItems), by ranges of grain items
+	// The calling thread works too, returns once every item is done
+	void run(RangeTask task, void* data, const unsigned int nbItems, const unsigned int grain);
+	// Threads working on a loop
+	inline unsigned int nbThreads() const { return m_workers.size() + 1; }
+
+	// Pool of the simulation (one worker per other core, made on first use)
+	static WorkerPool& shared();
+	// Stop the pool of the simulation
+	static void releaseShared();
+
+private :
+	// Worker thread entry point
+	static int _workerLoop(void* pool);
+	// Take and run ranges until none is left (mutex locked)
+	void _runRanges();
+};
+
+#endif // __WORKERPOOL_HPP__
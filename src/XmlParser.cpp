@@ -2,26 +2,63 @@
 #include "Camera.hpp"
 #include "Mesh.hpp"
 #include "Boids.hpp"
+#include "Tools.hpp"
+#include "Random.hpp"
+#include "CachedFigure.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+// Allowed attributes of each element (NULL ended)
+static const char* const SCENE_ATTRIBUTES[] = { "seed", NULL };
+static const char* const CAMERA_ATTRIBUTES[] = { "filepath", "start", "end", NULL };
+static const char* const RENDER_ATTRIBUTES[] = { "outputRoot", "width", "height", "pixelSamples", "fov", \
+	"passes", "ribEncoding", "gzip", "boids", "writers", NULL };
+static const char* const MESH_ATTRIBUTES[] = { "name", "filepath", "density", "start", "end", "boidsSystem", \
+	"boidsSystemPath", "boidsStart", "boidsEnd", "lod", "explosion", "frameStorage", NULL };
+static const char* const BOIDS_ATTRIBUTES[] = { "name", "nbUnities", "boxSize", "filepath", "start", "end", "lod", \
+	"explosion", "cache", NULL };
+static const char* const TRANSFORM_ATTRIBUTES[] = { "frame", "translate", "rotate", "scale", NULL };
+static const char* const EXPLOSION_ATTRIBUTES[] = { "speed", "fade", "interpolation", NULL };
+static const char* const POINT_ATTRIBUTES[] = { "distance", "factor", NULL };
+static const char* const ORIGIN_ATTRIBUTES[] = { "position", NULL };
 
 // Builder
 XmlParser::XmlParser(const std::string file, Application * application):
 m_application(application),
-m_xmlFile(file)
+m_xmlFile(file),
+m_nbErrors(0)
 {
 	_readXmlFile();
-	_parseCamera();
+	_parseScene();
+	// Camera and render options are needed before the window opens
+	tool_random::setSeed(m_scene.seed);
+	_defineCamera();
+	tool_renderman::setRenderSettings(m_scene.render);
+	m_application->setRenderWriters(m_scene.renderWriters);
+}
+
+// Build the figures of the scene (meshes, then boids systems)
+// Can run on the application loader thread
+void XmlParser::addFigures()
+{
 	_addMeshes();
 	_addBoidsSystems();
 }
 
+// Number of figures described in the scene
+unsigned int XmlParser::nbFigures() const
+{
+	return m_scene.meshes.size() + m_scene.boidsSystems.size();
+}
+
 
 // Utils
-// Read Xml file
+// Read Xml file (only parse of the file)
 void XmlParser::_readXmlFile()
 {
-	// Open the providen Xml file 
-	pugi::xml_document doc;
-	pugi::xml_parse_result result = doc.load_file(m_xmlFile.c_str());
+	// Open the providen Xml file
+	pugi::xml_parse_result result = m_document.load_file(m_xmlFile.c_str());
 	if(!result)
 	{
 		std::cout << "Error: Xml parsing - " << result.description() << std::endl;
@@ -30,32 +67,319 @@ void XmlParser::_readXmlFile()
 	}
 }
 
-// Get scene node from Xml file
-pugi::xml_node XmlParser::_getScene()
+// Check the file and fill the scene description
+// Every error of the file is reported before leaving
+void XmlParser::_parseScene()
 {
-	pugi::xml_document doc;
-	doc.load_file(m_xmlFile.c_str());
-	return doc.child("scene");
+	pugi::xml_node scene = m_document.child("scene");
+	if(!scene)
+	{
+		std::cout << "Error: Xml scene - no <scene> root element in " << m_xmlFile << std::endl;
+		exit(2);
+	}
+	// Same seed, same random numbers (see tool_random)
+	_checkAttributes(scene, SCENE_ATTRIBUTES);
+	m_scene.seed = 0;
+	_readUInt(scene, "seed", m_scene.seed);
+	_parseCamera(scene);
+	_parseRender(scene);
+	_parseMeshes(scene);
+	_parseBoidsSystems(scene);
+	if(m_nbErrors > 0)
+	{
+		std::cout << "Error: Xml scene - " << m_nbErrors << " error(s) in " << m_xmlFile << std::endl;
+		exit(2);
+	}
+	// Everything is in the description now
+	m_document.reset();
 }
 
 // Parse camera information
-void XmlParser::_parseCamera()
+void XmlParser::_parseCamera(const pugi::xml_node& scene)
+{
+	// Always only one camera, none : FPS camera only
+	pugi::xml_node camera = scene.child("camera");
+	m_scene.camera.filepath = camera.attribute("filepath").value();
+	m_scene.camera.start = 0;
+	m_scene.camera.end = 0;
+	if(!camera)
+		return;
+	_checkAttributes(camera, CAMERA_ATTRIBUTES);
+	_readUInt(camera, "start", m_scene.camera.start);
+	_readUInt(camera, "end", m_scene.camera.end);
+
+	// Animated camera providen
+	if(m_scene.camera.end != 0)
+	{
+		if(m_scene.camera.filepath.empty())
+			_error(camera, "animated camera without filepath");
+		if(m_scene.camera.end < m_scene.camera.start)
+			_error(camera, "end frame before start frame");
+	}
+}
+
+// Parse render (RIB output) options
+void XmlParser::_parseRender(const pugi::xml_node& scene)
+{
+	// Render node is optional : every value has a default
+	pugi::xml_node render = scene.child("render");
+	tool_renderman::RenderSettings& settings = m_scene.render;
+	settings = tool_renderman::defaultRenderSettings();
+	// RIB files are written by 1 background thread by default
+	m_scene.renderWriters = 1;
+	if(!render)
+		return;
+	_checkAttributes(render, RENDER_ATTRIBUTES);
+
+	// Output files
+	if(render.attribute("outputRoot"))
+		settings.outputRoot = render.attribute("outputRoot").value();
+	std::string ribEncoding = render.attribute("ribEncoding").value();
+	if(ribEncoding == "binary")
+		settings.encoding = RibWriter::BINARY;
+	else if(ribEncoding != "" && ribEncoding != "ascii")
+		_error(render, "unknown ribEncoding \"" + ribEncoding + "\" (ascii or binary)");
+	settings.compressed = render.attribute("gzip").as_bool();
+
+	// Image
+	unsigned int width = settings.xResolution;
+	unsigned int height = settings.yResolution;
+	if(_readUInt(render, "width", width) && width == 0)
+		_error(render, "width must be positive");
+	if(_readUInt(render, "height", height) && height == 0)
+		_error(render, "height must be positive");
+	settings.xResolution = width;
+	settings.yResolution = height;
+	if(_readFloat(render, "pixelSamples", settings.pixelSamples) && settings.pixelSamples <= 0.0f)
+		_error(render, "pixelSamples must be positive");
+	if(_readFloat(render, "fov", settings.fov) && (settings.fov <= 0.0f || settings.fov >= 180.0f))
+		_error(render, "fov must be between 0 and 180 degrees");
+
+	// Passes : comma separated list among matte, skin, reflect, boids
+	if(render.attribute("passes"))
+	{
+		settings.passes = 0;
+		std::stringstream passes(render.attribute("passes").value());
+		std::string pass;
+		while(std::getline(passes, pass, ','))
+		{
+			// Spaces around the names are allowed ("matte, skin")
+			const std::string::size_type first = pass.find_first_not_of(" \t\n\r");
+			const std::string::size_type last = pass.find_last_not_of(" \t\n\r");
+			pass = (first == std::string::npos) ? "" : pass.substr(first, last - first + 1);
+			if(pass == "matte")
+				settings.passes |= tool_renderman::PASS_MATTE;
+			else if(pass == "skin")
+				settings.passes |= tool_renderman::PASS_SKIN;
+			else if(pass == "reflect")
+				settings.passes |= tool_renderman::PASS_REFLECT;
+			else if(pass == "boids")
+				settings.passes |= tool_renderman::PASS_BOIDS;
+			else
+				_error(render, "unknown render pass \"" + pass + "\" (matte, skin, reflect or boids)");
+		}
+	}
+
+	// Boids are exported as spheres by default
+	std::string boids = render.attribute("boids").value();
+	if(boids == "points")
+		settings.boidsPrimitive = tool_renderman::BOIDS_POINTS;
+	else if(boids != "" && boids != "spheres")
+		_error(render, "unknown boids primitive \"" + boids + "\" (spheres or points)");
+
+	_readUInt(render, "writers", m_scene.renderWriters);
+}
+
+// Parse Meshes
+void XmlParser::_parseMeshes(const pugi::xml_node& scene)
+{
+	pugi::xml_node meshes = scene.child("meshes");
+	for(pugi::xml_node node = meshes.first_child(); node; node = node.next_sibling())
+	{
+		if(std::string(node.name()) != "mesh")
+		{
+			_error(node, "unknown element in <meshes>");
+			continue;
+		}
+		_checkAttributes(node, MESH_ATTRIBUTES);
+		Temp_Mesh meshInfo;
+		meshInfo.name = node.attribute("name").value();
+		meshInfo.filepath = node.attribute("filepath").value();
+		meshInfo.start = meshInfo.end = 0;
+		meshInfo.density = 1.0f;
+		meshInfo.lodDensity = 0.0f;
+		meshInfo.boidsSystem = meshInfo.boidsStart = meshInfo.boidsEnd = 0;
+		meshInfo.boidsSystemPath = node.attribute("boidsSystemPath").value();
+		meshInfo.explosion = 0;
+		meshInfo.frameStorage = FRAMES_QUANTIZED;
+
+		if(meshInfo.filepath.empty())
+			_error(node, "mesh without filepath");
+		_readUInt(node, "start", meshInfo.start);
+		if(_readUInt(node, "end", meshInfo.end) && meshInfo.end != 0 && meshInfo.end < meshInfo.start)
+			_error(node, "end frame before start frame");
+		if(_readFloat(node, "density", meshInfo.density) && (meshInfo.density <= 0.0f || meshInfo.density > 1.0f))
+			_error(node, "density must be in ]0,1]");
+		if(_readFloat(node, "lod", meshInfo.lodDensity) && meshInfo.lodDensity < 0.0f)
+			_error(node, "lod must be positive");
+		std::string frameStorage = node.attribute("frameStorage").value();
+		if(frameStorage == "float")
+			meshInfo.frameStorage = FRAMES_FLOAT;
+		else if(frameStorage == "delta")
+			meshInfo.frameStorage = FRAMES_DELTA;
+		else if(frameStorage != "" && frameStorage != "quantized")
+			_error(node, "unknown frameStorage \"" + frameStorage + "\" (float, quantized or delta)");
+		_readUInt(node, "explosion", meshInfo.explosion);
+		meshInfo.explosionSettings = _parseExplosion(node);
+
+		// Turn into a boids system following the boidsSystemPath leader
+		_readUInt(node, "boidsSystem", meshInfo.boidsSystem);
+		_readUInt(node, "boidsStart", meshInfo.boidsStart);
+		_readUInt(node, "boidsEnd", meshInfo.boidsEnd);
+		if(meshInfo.boidsSystem != 0 && meshInfo.boidsSystemPath.empty())
+			_error(node, "boidsSystem frame without boidsSystemPath");
+		if(meshInfo.boidsSystem != 0 && meshInfo.boidsEnd < meshInfo.boidsStart)
+			_error(node, "boidsEnd frame before boidsStart frame");
+
+		meshInfo.transformKeys = _parseTransformKeys(node);
+		m_scene.meshes.push_back(meshInfo);
+	}
+}
+
+// Parse Boids systems
+void XmlParser::_parseBoidsSystems(const pugi::xml_node& scene)
+{
+	pugi::xml_node boidsSystems = scene.child("boidsSystems");
+	for(pugi::xml_node node = boidsSystems.first_child(); node; node = node.next_sibling())
+	{
+		if(std::string(node.name()) != "boidsSystem")
+		{
+			_error(node, "unknown element in <boidsSystems>");
+			continue;
+		}
+		_checkAttributes(node, BOIDS_ATTRIBUTES);
+		Temp_Boids boidInfo;
+		boidInfo.name = node.attribute("name").value();
+		boidInfo.filepath = node.attribute("filepath").value();
+		boidInfo.nbUnities = 0;
+		boidInfo.boxSize = Boids::DEFAULT_SIZE_BOX;
+		boidInfo.start = boidInfo.end = 0;
+		boidInfo.explosion = 0;
+		boidInfo.lodDensity = 0.0f;
+		boidInfo.cachePath = node.attribute("cache").value();
+
+		if(_readUInt(node, "nbUnities", boidInfo.nbUnities) && boidInfo.nbUnities == 0)
+			_error(node, "nbUnities must be positive");
+		if(_readFloat(node, "boxSize", boidInfo.boxSize) && boidInfo.boxSize <= 0.0f)
+			_error(node, "boxSize must be positive");
+		_readUInt(node, "start", boidInfo.start);
+		_readUInt(node, "end", boidInfo.end);
+		// Animated leader of boids system providen
+		if(boidInfo.end != 0 && boidInfo.filepath.empty())
+			_error(node, "animated leader without filepath");
+		if(boidInfo.end != 0 && boidInfo.end < boidInfo.start)
+			_error(node, "end frame before start frame");
+		if(_readFloat(node, "lod", boidInfo.lodDensity) && boidInfo.lodDensity < 0.0f)
+			_error(node, "lod must be positive");
+		_readUInt(node, "explosion", boidInfo.explosion);
+		boidInfo.explosionSettings = _parseExplosion(node);
+
+		boidInfo.transformKeys = _parseTransformKeys(node);
+		m_scene.boidsSystems.push_back(boidInfo);
+	}
+}
+
+// Parse the <transform> keys of a figure node
+// <transform frame="" translate="x y z" rotate="x y z" scale="x y z" />
+std::vector<TransformKey> XmlParser::_parseTransformKeys(const pugi::xml_node& figure)
 {
-	// Read and Add camera information
-	// Always only one camera
-	pugi::xml_node camera = _getScene().child("camera");
-	std::string filepath = camera.attribute("filepath").value();
-	int start = camera.attribute("start").as_int();
-	int end = camera.attribute("end").as_int();
+	std::vector<TransformKey> keys;
+	for(pugi::xml_node key = figure.child("transform"); key; key = key.next_sibling("transform"))
+	{
+		_checkAttributes(key, TRANSFORM_ATTRIBUTES);
+		TransformKey transformKey;
+		transformKey.frame = 0;
+		transformKey.translate = Vec3(0.0f, 0.0f, 0.0f);
+		transformKey.rotate = Vec3(0.0f, 0.0f, 0.0f);
+		transformKey.scale = Vec3(1.0f, 1.0f, 1.0f);
+		_readUInt(key, "frame", transformKey.frame);
+		_readVec3(key, "translate", transformKey.translate);
+		_readVec3(key, "rotate", transformKey.rotate);
+		_readVec3(key, "scale", transformKey.scale);
+		keys.push_back(transformKey);
+	}
+	return keys;
+}
+
+// Helper : order the falloff points by distance
+static bool _pointBefore(const FalloffPoint& a, const FalloffPoint& b)
+{
+	return a.distance < b.distance;
+}
+
+// Parse the <explosion> shape of a figure node (none : default shape)
+// <explosion speed="" fade="" interpolation="step|linear">
+//	<point distance="" factor="" />		falloff control points
+//	<origin position="x y z" />		impacts (object space)
+// </explosion>
+ExplosionSettings XmlParser::_parseExplosion(const pugi::xml_node& figure)
+{
+	ExplosionSettings settings = Explosion::defaultSettings();
+	pugi::xml_node explosion = figure.child("explosion");
+	if(!explosion)
+		return settings;
+	_checkAttributes(explosion, EXPLOSION_ATTRIBUTES);
+	if(_readFloat(explosion, "speed", settings.speed) && settings.speed <= 0.0f)
+		_error(explosion, "speed must be positive");
+	if(_readFloat(explosion, "fade", settings.fade) && settings.fade < 0.0f)
+		_error(explosion, "fade must be positive");
+	const std::string interpolation = explosion.attribute("interpolation").value();
+	if(interpolation == "linear")
+		settings.linearFalloff = true;
+	else if(interpolation != "" && interpolation != "step")
+		_error(explosion, "unknown interpolation \"" + interpolation + "\" (step or linear)");
+
+	// Control points replace the default falloff
+	if(explosion.child("point"))
+		settings.falloff.clear();
+	for(pugi::xml_node node = explosion.child("point"); node; node = node.next_sibling("point"))
+	{
+		_checkAttributes(node, POINT_ATTRIBUTES);
+		FalloffPoint point;
+		point.distance = 0.0f;
+		point.factor = 1.0f;
+		if(_readFloat(node, "distance", point.distance) && point.distance < 0.0f)
+			_error(node, "distance must be positive");
+		if(_readFloat(node, "factor", point.factor) && point.factor <= 0.0f)
+			_error(node, "factor must be positive");
+		settings.falloff.push_back(point);
+	}
+	std::stable_sort(settings.falloff.begin(), settings.falloff.end(), _pointBefore);
+
+	for(pugi::xml_node node = explosion.child("origin"); node; node = node.next_sibling("origin"))
+	{
+		_checkAttributes(node, ORIGIN_ATTRIBUTES);
+		Vec3 origin;
+		if(!node.attribute("position"))
+			_error(node, "origin without position");
+		else if(_readVec3(node, "position", origin))
+			settings.origins.push_back(origin);
+	}
+	return settings;
+}
 
+// Define the application camera
+void XmlParser::_defineCamera()
+{
+	const Temp_Camera& cameraInfo = m_scene.camera;
 	// Create the application camera
 	Camera * new_camera;
 
 	// Animated camera providen
-	if(end == 0)
+	if(cameraInfo.end == 0)
 		new_camera = new Camera();
 	else
-		new_camera = new Camera(filepath, start, end);
+		new_camera = new Camera(cameraInfo.filepath, cameraInfo.start, cameraInfo.end);
 	// Add the camera into the Application
 	m_application->defineCamera(new_camera);
 }
@@ -63,77 +387,46 @@ void XmlParser::_parseCamera()
 // Add Meshes
 void XmlParser::_addMeshes()
 {
-	std::vector<Temp_Mesh> meshVector;
-	std::vector<AnimatedData> animatedMeshVector;
-	pugi::xml_node meshes = _getScene().child("meshes");
-	// For each mesh found add it to the application
-	for (pugi::xml_node_iterator it = meshes.begin(); it != meshes.end(); ++it)
-	{
-		Temp_Mesh meshInfo ;
-		meshInfo.name = it->attribute("name").value();
-		meshInfo.filepath = it->attribute("filepath").value();
-		meshInfo.start = it->attribute("start").as_int();
-		meshInfo.end = it->attribute("end").as_int();
-		if(it->attribute("density"))
-			meshInfo.density = it->attribute("density").as_float();
-		else
-			meshInfo.density = 1.0f;
-		
-
-		// Test animated figure
-		AnimatedData animated_mesh;
-		int turnInto_boidsSystem = 0;
-		int turnInto_explosion = 0;
-		std::string boidsSystemPath = "";
-		if(it->attribute("boidsSystemPath"))
-		{
-			boidsSystemPath = it->attribute("boidsSystemPath").value();
-			if(it->attribute("boidsSystem"))
-		 		turnInto_boidsSystem = it->attribute("boidsSystem").as_int();
-		}
-		if(it->attribute("explosion"))
-			turnInto_explosion = it->attribute("explosion").as_int();
-
-		if(turnInto_boidsSystem != 0 || turnInto_explosion != 0)
-		{
-			animated_mesh.indexFigure = meshVector.size();
-			animated_mesh.meshFilesPath = meshInfo.filepath;
-			animated_mesh.m_startSequence = meshInfo.start;
-			animated_mesh.m_endSequence = meshInfo.end;
-			animated_mesh.frameExplosion = animated_mesh.frameBoids = 0;
-			animated_mesh.m_density = meshInfo.density;
-			if(turnInto_boidsSystem != 0)
-			{
-				animated_mesh.frameBoids = turnInto_boidsSystem;
-				animated_mesh.boidFilesPath = boidsSystemPath;
-				animated_mesh.b_startSequence = (unsigned int)it->attribute("boidsStart").as_int();
-				animated_mesh.b_endSequence = (unsigned int)it->attribute("boidsEnd").as_int();
-			}
-			if(turnInto_explosion != 0)
-				animated_mesh.frameExplosion = turnInto_explosion;
-			animatedMeshVector.push_back(animated_mesh);
-		}
-		meshVector.push_back(meshInfo);
-	}
 	// For each mesh info, add it to the application
-	for(unsigned int i=0; i<meshVector.size(); ++i)
+	for(unsigned int i=0; i<m_scene.meshes.size(); ++i)
 	{
-		Temp_Mesh meshInfo = meshVector[i];
-		// Generate the mesh	
+		const Temp_Mesh& meshInfo = m_scene.meshes[i];
+		// Generate the mesh
 		Mesh * new_mesh ;
+		// Random key : rank of the figure in the scene
+		const uint32_t randomKey = i;
 		// Animated mesh providen
 		if(meshInfo.end == 0)
-			new_mesh = new Mesh(meshInfo.filepath, meshInfo.density);
+			new_mesh = new Mesh(meshInfo.filepath, meshInfo.density, randomKey, meshInfo.frameStorage);
 		else
-			new_mesh = new Mesh(meshInfo.filepath, meshInfo.start, meshInfo.end, meshInfo.density);
+			new_mesh = new Mesh(meshInfo.filepath, meshInfo.start, meshInfo.end, meshInfo.density, randomKey,
+			                    meshInfo.frameStorage);
 		new_mesh->setName(meshInfo.name);
-		// Look for a potential animated mesh
-		if(animatedMeshVector.size() > 0 && animatedMeshVector.at(0).indexFigure == i)
+		new_mesh->setTransformKeys(meshInfo.transformKeys);
+		new_mesh->setLodDensity(meshInfo.lodDensity);
+		// Animated mesh : turns into a boids system or an explosion
+		if(meshInfo.boidsSystem != 0 || meshInfo.explosion != 0)
 		{
-			AnimatedData animated_mesh = animatedMeshVector[0];
+			AnimatedData animated_mesh;
 			animated_mesh.indexFigure = m_application->nbUnities();
+			animated_mesh.meshFilesPath = meshInfo.filepath;
+			animated_mesh.m_startSequence = meshInfo.start;
+			animated_mesh.m_endSequence = meshInfo.end;
+			animated_mesh.m_density = meshInfo.density;
+			animated_mesh.frameStorage = meshInfo.frameStorage;
+			animated_mesh.transformKeys = meshInfo.transformKeys;
+			animated_mesh.lodDensity = meshInfo.lodDensity;
+			animated_mesh.frameBoids = meshInfo.boidsSystem;
+			animated_mesh.frameExplosion = meshInfo.explosion;
+			animated_mesh.explosionSettings = meshInfo.explosionSettings;
+			animated_mesh.randomKey = randomKey;
+			if(meshInfo.boidsSystem != 0)
+			{
+				animated_mesh.boidFilesPath = meshInfo.boidsSystemPath;
+				animated_mesh.b_startSequence = meshInfo.boidsStart;
+				animated_mesh.b_endSequence = meshInfo.boidsEnd;
+			}
 			m_application->addAnimatedData(animated_mesh);
-			animatedMeshVector.erase(animatedMeshVector.begin());
 		}
 		// Add the new mesh into the Application
 		m_application->addFigure(new_mesh);
@@ -143,56 +436,154 @@ void XmlParser::_addMeshes()
 // Add Boids systems
 void XmlParser::_addBoidsSystems()
 {
-	std::vector<Temp_Boids> boidsVector;
-	std::vector<AnimatedData> animatedBoidsVector;
-	pugi::xml_node boidsSystems = _getScene().child("boidsSystems");
-	// For each boids system found store the information
-	for (pugi::xml_node_iterator it = boidsSystems.begin(); it != boidsSystems.end(); ++it)
-	{
-		Temp_Boids boidInfo;
-		boidInfo.name = it->attribute("name").value();
-		boidInfo.nbUnities = it->attribute("nbUnities").as_int();
-		boidInfo.filepath = it->attribute("filepath").value(); 
-		boidInfo.start = it->attribute("start").as_int();	
-		boidInfo.end = it->attribute("end").as_int();
-
-		int turnInto_explosion = 0;
-		if(it->attribute("explosion"))
-			turnInto_explosion = it->attribute("explosion").as_int();
-		if(turnInto_explosion != 0)
-		{
-			AnimatedData animated_boid;
-			animated_boid.indexFigure = boidsVector.size();
-			animated_boid.boidFilesPath = boidInfo.filepath;
-			animated_boid.b_nbUnities = boidInfo.nbUnities;
-			animated_boid.b_startSequence = boidInfo.start;
-			animated_boid.b_endSequence = boidInfo.end;
-			animated_boid.frameExplosion = turnInto_explosion;
-			animatedBoidsVector.push_back(animated_boid);
-		}
-		boidsVector.push_back(boidInfo);
-	}
 	// For each boids system info, add it into the application
-	for(unsigned int i=0; i<boidsVector.size(); ++i)
+	for(unsigned int i=0; i<m_scene.boidsSystems.size(); ++i)
 	{
-		Temp_Boids boidInfo = boidsVector[i];
-		// Generate the boids system	
+		const Temp_Boids& boidInfo = m_scene.boidsSystems[i];
+		// Generate the boids system
 		Boids * new_boids ;
+		// Random key : rank of the figure in the scene
+		const uint32_t randomKey = m_scene.meshes.size() + i;
+		// Simulated by a previous run : replayed from its particle cache
+		// (the explosion is in the recorded frames)
+		if(!boidInfo.cachePath.empty())
+		{
+			ParticleCache* cache = new ParticleCache(boidInfo.cachePath);
+			if(cache->isValid() && cache->nbFrames() > 0)
+			{
+				CachedFigure* cached = new CachedFigure(cache, randomKey);
+				cached->setName(boidInfo.name);
+				cached->setTransformKeys(boidInfo.transformKeys);
+				cached->setLodDensity(boidInfo.lodDensity);
+				m_application->addFigure(cached);
+				continue;
+			}
+			delete cache;
+		}
 		// Animated leader of boids system providen
 		if(boidInfo.end == 0)
-			new_boids = new Boids(boidInfo.nbUnities);
+			new_boids = new Boids(boidInfo.nbUnities, boidInfo.boxSize, randomKey);
 		else
-			new_boids = new Boids(boidInfo.nbUnities, boidInfo.filepath, boidInfo.start, boidInfo.end);
+			new_boids = new Boids(boidInfo.nbUnities, boidInfo.filepath, boidInfo.start, boidInfo.end, \
+					      boidInfo.boxSize, randomKey);
 		new_boids->setName(boidInfo.name);
-		// Look for any potential animated boids system
-		if(animatedBoidsVector.size() > 0 && animatedBoidsVector[0].indexFigure == i)
+		new_boids->setTransformKeys(boidInfo.transformKeys);
+		new_boids->setLodDensity(boidInfo.lodDensity);
+		// Particle cache : recorded by the first play sequence
+		if(!boidInfo.cachePath.empty())
+		{
+			ParticleCacheWriter* recorder = new ParticleCacheWriter(boidInfo.cachePath);
+			new_boids->setRecorder(recorder);
+			m_application->addRecorder(recorder);
+		}
+		// Animated boids system : turns into an explosion
+		if(boidInfo.explosion != 0)
 		{
-			AnimatedData animated_boid = animatedBoidsVector[0];
+			AnimatedData animated_boid;
 			animated_boid.indexFigure = m_application->nbUnities();
+			animated_boid.boidFilesPath = boidInfo.filepath;
+			animated_boid.b_nbUnities = boidInfo.nbUnities;
+			animated_boid.b_sizeBox = boidInfo.boxSize;
+			animated_boid.b_startSequence = boidInfo.start;
+			animated_boid.b_endSequence = boidInfo.end;
+			animated_boid.frameExplosion = boidInfo.explosion;
+			animated_boid.explosionSettings = boidInfo.explosionSettings;
+			animated_boid.randomKey = randomKey;
+			animated_boid.transformKeys = boidInfo.transformKeys;
+			animated_boid.lodDensity = boidInfo.lodDensity;
 			m_application->addAnimatedData(animated_boid);
-			animatedBoidsVector.erase(animatedBoidsVector.begin());
 		}
 		// Add the new boids system into the Application
 		m_application->addFigure(new_boids);
 	}
 }
+
+// Helper : parse a whole text as a number (spaces around are allowed)
+template <typename T>
+static bool _parseNumber(const std::string& text, T& value)
+{
+	std::stringstream stream(text);
+	T parsed;
+	if(!(stream >> parsed) || !(stream >> std::ws).eof())
+		return false;
+	value = parsed;
+	return true;
+}
+
+// Read an unsigned integer attribute (absent or empty : value kept)
+// false and an error when the value is not a positive integer
+bool XmlParser::_readUInt(const pugi::xml_node& node, const char* name, unsigned int& value)
+{
+	const std::string text = node.attribute(name).value();
+	if(text.empty())
+		return true;
+	// Read signed : a negative value is an error, not a wrapped one
+	long parsed = 0;
+	if(!_parseNumber(text, parsed) || parsed < 0)
+	{
+		_error(node, std::string(name) + "=\"" + text + "\" is not a positive integer");
+		return false;
+	}
+	value = (unsigned int)parsed;
+	return true;
+}
+
+// Read a float attribute (absent or empty : value kept)
+// false and an error when the value is not a number
+bool XmlParser::_readFloat(const pugi::xml_node& node, const char* name, float& value)
+{
+	const std::string text = node.attribute(name).value();
+	if(text.empty())
+		return true;
+	if(!_parseNumber(text, value))
+	{
+		_error(node, std::string(name) + "=\"" + text + "\" is not a number");
+		return false;
+	}
+	return true;
+}
+
+// Read a "x y z" attribute (absent or empty : value kept)
+// false and an error when the value is not 3 numbers
+bool XmlParser::_readVec3(const pugi::xml_node& node, const char* name, Vec3& value)
+{
+	const std::string text = node.attribute(name).value();
+	if(text.empty())
+		return true;
+	Vec3 parsed;
+	std::stringstream values(text);
+	if(!(values >> parsed.x >> parsed.y >> parsed.z) || !(values >> std::ws).eof())
+	{
+		_error(node, std::string(name) + "=\"" + text + "\" is not a \"x y z\" vector");
+		return false;
+	}
+	value = parsed;
+	return true;
+}
+
+// Warn about the attributes of a node not in the allowed list (NULL ended)
+// Catches the misspelled attributes, silently ignored otherwise
+void XmlParser::_checkAttributes(const pugi::xml_node& node, const char* const* allowed)
+{
+	for(pugi::xml_attribute attribute = node.first_attribute(); attribute; attribute = attribute.next_attribute())
+	{
+		const std::string name = attribute.name();
+		unsigned int i = 0;
+		while(allowed[i] != NULL && name != allowed[i])
+			++i;
+		if(allowed[i] == NULL)
+			std::cout << "WARNING Xml scene - unknown attribute " << name << " of <" << node.name() \
+				  << "> (offset " << node.offset_debug() << ")" << std::endl;
+	}
+}
+
+// Report an error on a node of the file
+// The figure name and the file offset locate the node
+void XmlParser::_error(const pugi::xml_node& node, const std::string& message)
+{
+	std::cout << "Error: Xml scene - <" << node.name();
+	if(node.attribute("name"))
+		std::cout << " name=\"" << node.attribute("name").value() << "\"";
+	std::cout << "> (offset " << node.offset_debug() << ") : " << message << std::endl;
+	++m_nbErrors;
+}
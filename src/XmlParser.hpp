@@ -2,6 +2,7 @@
 #define __XMLREADER_HPP__
 
 #include "Application.hpp"
+#include "Tools.hpp"
 #include "utils/pugixml/pugixml.hpp"
 
 #include <ctime>
@@ -10,9 +11,15 @@
 #include <vector>
 #include <string>
 
-//@WARNING PugiXML issue : initialize any pointer when working with the 
-// library looks like breaking the XML parsing. Need to load all of 
-// the information, then create the elements.
+// Scene description : the XML file is read and checked once,
+// then the elements are created from these values.
+typedef struct
+{
+	std::string filepath;
+	unsigned int start;
+	unsigned int end;			// 0 : FPS camera only
+} Temp_Camera;
+
 typedef struct
 {
 	std::string name;
@@ -20,18 +27,42 @@ typedef struct
 	unsigned int start;
 	unsigned int end;
 	float density;
+	float lodDensity;
+	FrameStorage frameStorage;		// how the frames are kept in memory
+	unsigned int boidsSystem;		// frame - turn into boids system (0 : never)
+	std::string boidsSystemPath;
+	unsigned int boidsStart;
+	unsigned int boidsEnd;
+	unsigned int explosion;			// frame - turn into an explosion (0 : never)
+	ExplosionSettings explosionSettings;
+	std::vector<TransformKey> transformKeys;
 } Temp_Mesh;
 
-typedef struct 
+typedef struct
 {
 	std::string name;
 	std::string filepath;
 	unsigned int nbUnities;
+	float boxSize;				// size of the box the boids start in
 	unsigned int start;
 	unsigned int end;
 	unsigned int explosion;
+	ExplosionSettings explosionSettings;
+	float lodDensity;
+	std::string cachePath;			// particle cache (replayed when valid, else recorded)
+	std::vector<TransformKey> transformKeys;
 }Temp_Boids;
 
+typedef struct
+{
+	unsigned int seed;			// seed of the random numbers
+	Temp_Camera camera;
+	tool_renderman::RenderSettings render;
+	unsigned int renderWriters;		// RIB writer threads
+	std::vector<Temp_Mesh> meshes;
+	std::vector<Temp_Boids> boidsSystems;
+} Temp_Scene;
+
 // Parse the scene XML file and build the application based on it
 // Uses the pugiXml library
 class XmlParser
@@ -39,22 +70,53 @@ class XmlParser
 private :
 	Application * m_application; 	// the FumiGen application
 	std::string m_xmlFile;		// Xml file
+	pugi::xml_document m_document;	// parsed file (released once described)
+	Temp_Scene m_scene;		// checked content of the file
+	unsigned int m_nbErrors;	// errors found in the file
 
 public :
-	// Builder
+	// Builder (reads the whole file, defines the camera and render options)
+	// Exits on an invalid scene file
 	XmlParser(const std::string file, Application * application);
+	// Build the figures of the scene (meshes, then boids systems)
+	// Can run on the application loader thread
+	void addFigures();
+	// Number of figures described in the scene
+	unsigned int nbFigures() const;
 private:
 	// Utils
-	// Read Xml file
+	// Read Xml file (only parse of the file)
 	void _readXmlFile();
+	// Check the file and fill the scene description
+	void _parseScene();
 	// Parse camera information
-	void _parseCamera();
+	void _parseCamera(const pugi::xml_node& scene);
+	// Parse render (RIB output) options
+	void _parseRender(const pugi::xml_node& scene);
+	// Parse Meshes
+	void _parseMeshes(const pugi::xml_node& scene);
+	// Parse Boids systems
+	void _parseBoidsSystems(const pugi::xml_node& scene);
+	// Parse the <transform> keys of a figure node
+	std::vector<TransformKey> _parseTransformKeys(const pugi::xml_node& figure);
+	// Parse the <explosion> shape of a figure node (none : default shape)
+	ExplosionSettings _parseExplosion(const pugi::xml_node& figure);
+	// Define the application camera
+	void _defineCamera();
 	// Add Meshes
 	void _addMeshes();
 	// Add Boids systems
 	void _addBoidsSystems();
-	// Get scene node from Xml file
-	pugi::xml_node _getScene();
+	// Read an unsigned integer attribute (absent or empty : value kept)
+	bool _readUInt(const pugi::xml_node& node, const char* name, unsigned int& value);
+	// Read a float attribute (absent or empty : value kept)
+	bool _readFloat(const pugi::xml_node& node, const char* name, float& value);
+	// Read a "x y z" attribute (absent or empty : value kept)
+	bool _readVec3(const pugi::xml_node& node, const char* name, Vec3& value);
+	// Warn about the attributes of a node not in the allowed list (NULL ended)
+	void _checkAttributes(const pugi::xml_node& node, const char* const* allowed);
+	// Report an error on a node of the file
+	void _error(const pugi::xml_node& node, const std::string& message);
 };
 
 #endif //__XMLREADER_HPP__
@@ -4,31 +4,48 @@
 
 
 //Create an Application
-Application* createApplication(const std::string xmlFile)
+// The window opens at once, the figures are built in background
+// memoryReport : print the memory of the scene once loaded and after each play sequence
+Application* createApplication(const std::string xmlFile, const bool memoryReport)
 {
 	Application* application = new Application(); 
-	XmlParser(xmlFile, application);
+	application->setMemoryReport(memoryReport);
+	XmlParser* parser = new XmlParser(xmlFile, application);
 	application->initApplication();
+	application->loadFigures(parser);
 	return application;
 }
 
 // Entry point in the program
 int main(int argc, char **argv)
 {
+	// Options : the scene file and --mem-report
+	std::string xmlFile = "";
+	bool memoryReport = false;
+	for(int i=1; i<argc; ++i)
+	{
+		const std::string argument = argv[i];
+		if(argument == "--mem-report")
+			memoryReport = true;
+		else if(argument.compare(0, 2, "--") == 0)
+			std::cout << "WARNING unknown option " << argument << std::endl;
+		else if(xmlFile == "")
+			xmlFile = argument;
+	}
 	// Application creation
-	if(argc < 2)
+	if(xmlFile == "")
 	{
 		std::cout << "Error: no XML scene file providen" << std::endl;
+		std::cout << "Usage: " << argv[0] << " scene.xml [--mem-report]" << std::endl;
 		exit(2);
 	}
-	std::string xmlFile = argv[1];
-	Application* application = createApplication(xmlFile);
+	Application* application = createApplication(xmlFile, memoryReport);
 		
 	// Render Loop
 	application->eventLoop();
 
 	//Quit
 	application->deleteApplication();
-	free(application);
+	delete application;
 	return 0;
 }